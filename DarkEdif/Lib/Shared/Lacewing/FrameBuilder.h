@@ -9,6 +9,7 @@
 */
 
 #include "MessageBuilder.h"
+#include <vector>
 
 // TODO: This isn't an ideal workaround.
 extern "C" size_t lwp_stream_write(lw_stream ctx, const char* buffer, size_t size, int flags);
@@ -17,6 +18,48 @@ extern "C" size_t lwp_stream_write(lw_stream ctx, const char* buffer, size_t siz
 #define lacewingframebuilder
 static const char zerothree[3] = { 0, 0, 0 };
 
+// An immutable message, already encoded for each transport it'll be sent on.
+// Made by framebuilder::encode(), so fanning one message out to many recipients, e.g. a channel,
+// formats the frame once, instead of per recipient or per switch between WebSocket and raw recipients.
+// Shared as std::shared_ptr<const encodedframe>, so any number of senders can hold on to it.
+struct encodedframe
+{
+	// Raw Lacewing frame; a UDP datagram if udp is true, otherwise a TCP frame. Empty if not encoded.
+	std::string raw;
+	// WebSocket binary frame. Empty if not encoded.
+	std::string websocket;
+	// Encoded from a UDP header, so raw is a datagram
+	bool udp = false;
+
+	inline void send(lacewing::server_client client) const
+	{
+		if (client->is_websocket())
+		{
+			assert(!websocket.empty() && "encodedframe wasn't encoded for WebSocket.");
+			lwp_stream_write((lw_stream)client, websocket.data(), websocket.size(), 2 /* lwp_stream_write_ignore_busy */);
+			return;
+		}
+
+		// UDP frames are only sent over TCP to pseudo-UDP clients, which are WebSocket
+		assert(!udp && !raw.empty() && "encodedframe wasn't encoded for raw TCP.");
+		client->write(raw.data(), raw.size());
+	}
+
+	inline void send(lacewing::udp udp, lacewing::address from, lw_ui32 ifidx, lacewing::address to) const
+	{
+		assert(this->udp && !raw.empty() && "encodedframe wasn't encoded for UDP.");
+		udp->send(from, ifidx, to, raw.data(), raw.size());
+	}
+
+	// Sends the datagram to all dests in as few syscalls as the OS allows
+	inline void send(lacewing::udp udp, const std::vector<lw_udp_dest>& dests) const
+	{
+		assert(this->udp && !raw.empty() && "encodedframe wasn't encoded for UDP.");
+		if (!dests.empty())
+			udp->send_batch(dests.data(), dests.size(), raw.data(), raw.size());
+	}
+};
+
 class framebuilder : public messagebuilder
 {
 protected:
@@ -134,6 +177,8 @@ protected:
 	int tosendsize;
 	lw_ui32 origUDP;
 	lw_i8 wasWebLast;
+	// addheader() was called with forudp
+	bool udpheader;
 
 public:
 
@@ -144,6 +189,7 @@ public:
 		tosendsize = 0;
 		origUDP = UINT32_MAX;
 		wasWebLast = -1;
+		udpheader = false;
 	}
 
 	inline void addheader(lw_ui8 type, lw_ui8 variant, bool forudp = false, int udpclientid = -1)
@@ -154,6 +200,7 @@ public:
 		assert(size == 0 && "lacewing framebuilder.addheader() error: adding header to message that already has one.");
 		assert(type <= 0xF && variant <= 0xF);
 
+		udpheader = forudp;
 		if (!forudp)
 		{
 			add <lw_ui32> ((type << 4) | variant);
@@ -219,6 +266,38 @@ public:
 			framereset();
 	}
 
+	// Encodes the message for raw Lacewing (TCP or UDP, as per addheader()) and/or WebSocket recipients.
+	// The builder is reset afterwards, as WebSocket encoding of large messages rewrites the buffer.
+	std::shared_ptr<const encodedframe> encode(bool forraw, bool forwebsocket)
+	{
+		if (threadOwner != std::this_thread::get_id())
+			LacewingFatalErrorMsgBox();
+
+		auto frame = std::make_shared<encodedframe>();
+		frame->udp = udpheader;
+
+		if (forraw)
+		{
+			if (frame->udp)
+				frame->raw.assign(&buffer[isudpclient ? 5 : 7], size - (isudpclient ? 5 : 7));
+			else
+			{
+				tosend = nullptr; // or preparefortransmission does nothing
+				preparefortransmission(false);
+				frame->raw.assign(tosend, tosendsize);
+			}
+		}
+		if (forwebsocket)
+		{
+			tosend = nullptr;
+			preparefortransmission(true);
+			frame->websocket.assign(tosend, tosendsize);
+		}
+
+		framereset();
+		return frame;
+	}
+
 	inline void framereset()
 	{
 		reset();
@@ -270,6 +270,8 @@ typedef enum _lw_addr_tostring_flags
 	lw_import		 void  lw_filter_set_remote_port (lw_filter, long port);
 	lw_import	  lw_bool  lw_filter_reuse			 (lw_filter);
 	lw_import		 void  lw_filter_set_reuse		 (lw_filter, lw_bool);
+	lw_import	  lw_bool  lw_filter_reuse_port		 (lw_filter);
+	lw_import		 void  lw_filter_set_reuse_port	 (lw_filter, lw_bool);
 	lw_import	  lw_bool  lw_filter_ipv6			 (lw_filter);
 	lw_import		 void  lw_filter_set_ipv6		 (lw_filter, lw_bool);
 	lw_import	  lw_bool  lw_filter_remote_mask	 (lw_filter);
@@ -358,6 +360,8 @@ typedef enum _lw_addr_tostring_flags
 	lw_import		lw_error  lw_eventpump_start_eventloop		(lw_eventpump);
 	lw_import		lw_error  lw_eventpump_start_sleepy_ticking	(lw_eventpump, void (lw_callback * on_tick_needed) (lw_eventpump));
 	lw_import			void  lw_eventpump_post_eventloop_exit	(lw_eventpump);
+	// Linux only: eventpumps made after this poll through io_uring instead of epoll. False if unsupported.
+	lw_import		 lw_bool  lw_eventpump_set_io_uring			(lw_bool enabled);
 
 	/* Stream */
 
@@ -536,6 +540,8 @@ typedef enum _lw_addr_tostring_flags
 	lw_import			 lw_bool  lw_server_can_npn			(lw_server);
 	lw_import				void  lw_server_add_npn			(lw_server, const char * protocol);
 	lw_import			  size_t  lw_server_num_clients		(lw_server);
+	lw_import				void  lw_server_set_reactors	(lw_server, size_t count);
+	lw_import			  size_t  lw_server_reactors		(lw_server);
 	lw_import	lw_server_client  lw_server_client_first	(lw_server);
 	lw_import	lw_server_client  lw_server_client_next		(lw_server_client);
 	lw_import			  void *  lw_server_tag				(lw_server);
@@ -582,6 +588,16 @@ typedef enum _lw_addr_tostring_flags
 		temporary and expire due to RFC 4941, particularly on Windows. */
 	lw_import		void  lw_udp_send		 (lw_udp, lw_addr local_addr, lw_ui32 ifidx, lw_addr remote_addr,
 											  const char* buffer, size_t size);
+	typedef struct _lw_udp_dest
+	{
+		lw_addr local;
+		lw_ui32 ifidx;
+		lw_addr remote;
+	} lw_udp_dest;
+	/*	Sends the same datagram to every destination, as lw_udp_send would one by one, but with
+		as few syscalls as the OS allows (sendmmsg on Linux). */
+	lw_import		void  lw_udp_send_batch	 (lw_udp, const lw_udp_dest * dests, size_t count,
+											  const char* buffer, size_t size);
 	lw_import	    void  lw_udp_send_unreachable (lw_udp, lw_addr local, lw_ui32 ifidx, lw_addr remote,
 												   const char* origMsg, lw_ui32 origMsgSize);
 	lw_import	  void *  lw_udp_tag		 (lw_udp);
@@ -1162,6 +1178,9 @@ struct _filter
 	lw_import void reuse (bool enabled);
 	lw_import bool reuse ();
 
+	lw_import void reuse_port (bool enabled);
+	lw_import bool reuse_port ();
+
 	lw_import void ipv6 (bool enabled);
 	lw_import bool ipv6 ();
 
@@ -1244,6 +1263,11 @@ struct _server
 	lw_import size_t num_clients ();
 	lw_import server_client client_first ();
 
+	// Number of event loops accepting and serving clients; takes effect on next host.
+	// Only Linux supports more than 1; extra reactors run on their own threads.
+	lw_import void reactors (size_t count);
+	lw_import size_t reactors ();
+
 	lw_import void hole_punch (address remote_addr, lw_ui16 local_port);
 
 	typedef void (lw_callback * hook_connect) (server, server_client);
@@ -1308,6 +1332,7 @@ struct _udp
 		you must specify your local address you're sending from, as local IPv6 addresses can be
 		temporary and expire due to RFC 4941, particularly on Windows. */
 	lw_import void send (address from, lw_ui32 ifidx, address to, const char * data, size_t size = -1);
+	lw_import void send_batch (const lw_udp_dest * dests, size_t count, const char * data, size_t size = -1);
 	lw_import void send_unreachable (address from, lw_ui32 ifidx, address to, const char* data, size_t size);
 
 	typedef void (lw_callback * hook_data)
@@ -2066,6 +2091,9 @@ struct relayserver
 	lw_ui16 port();
 
 	void setchannellisting(bool enabled);
+	// Number of event loop threads for TCP clients, applied on next host(). Linux only.
+	void setreactorcount(size_t count);
+	size_t getreactorcount();
 	void setwelcomemessage(std::string_view message);
 	std::string getwelcomemessage();
 
@@ -2236,6 +2264,10 @@ struct relayserver
 		// Has a TCP ping request been sent by server, and was replied to.
 		// If false, next ping timer tick will consider a failed ping and kick the client, so it is true by default.
 		bool pongedOnTCP = true;
+		// When the last TCP and UDP pings were sent by server, if ever
+		::std::chrono::steady_clock::time_point tcppingsenttime, udppingsenttime;
+		// Ping timer tick this client is next checked on; see relayserverinternal::pingwheel
+		lw_ui64 pingwheeltick = 0;
 
 		// Has a UDP message received, confirming its UDP address. Implies psuedoUDP is false.
 		bool lockedUDPAddress = false;
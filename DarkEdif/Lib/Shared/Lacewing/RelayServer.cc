@@ -24,6 +24,7 @@
 #include <time.h>
 #include <ctime>
 #include <map>
+#include <unordered_map>
 #include <iostream>
 
 #define lwp_stream_write_ignore_filters  1
@@ -139,6 +140,7 @@ struct relayserverinternal
 			//delete c;
 		}
 		clients.clear();
+		clientsbyid.clear();
 
 		for (auto& c : channels)
 		{
@@ -168,6 +170,22 @@ struct relayserverinternal
 	std::vector<std::shared_ptr<relayserver::client>> clients;
 	std::vector<std::shared_ptr<relayserver::channel>> channels;
 
+	// Mirrors clients, indexed by client ID, so message handlers can recover a client's shared_ptr
+	// without a linear search of the server's client list. IDs are unique while a client is in the list,
+	// as the ID is not returned to clientids until the client is destroyed.
+	// Guarded by lock_clientlist, same as clients.
+	std::unordered_map<lw_ui16, std::shared_ptr<relayserver::client>> clientsbyid;
+
+	// Adds client to server's client list. Expects lock_clientlist write lock to be held.
+	void addclienttolist(std::shared_ptr<relayserver::client> client);
+	// Drops client from server's client list, if present. Expects lock_clientlist write lock to be held.
+	void removeclientfromlist(const std::shared_ptr<relayserver::client>& client);
+	// Looks up client by ID, returns null if not in server's client list. Expects lock_clientlist read lock to be held.
+	std::shared_ptr<relayserver::client> getclientbyid(lw_ui16 id) const;
+	// Looks up shared_ptr owner of the given client, returns null if not in server's client list.
+	// Expects lock_clientlist read lock to be held.
+	std::shared_ptr<relayserver::client> getclientshared(const relayserver::client* client) const;
+
 	bool channellistingenabled;
 
 	// How long, in ms, a Relay connection can be inactive on TCP before it is sent a TCP ping;
@@ -186,8 +204,132 @@ struct relayserverinternal
 	long actionThreadMS;
 	std::size_t numActionsPerTick;
 
+	// Ping timer ticks this many times per tcpPingMS, so clients are checked close to their own deadlines,
+	// rather than the whole server at once.
+	static constexpr long pingTicksPerPingPeriod = 8;
+
+	// Two-level timing wheel for the ping timer. Each client sits in the slot for the tick it next needs
+	// checking on, so a tick only visits clients that are due, instead of every client on the server.
+	// Entries aren't removed when a client disconnects or is rescheduled; instead, they're skipped when
+	// the client has expired, or its pingwheeltick no longer matches the entry.
+	struct pingtimerwheel
+	{
+		static constexpr lw_ui64 slotsPerLevel = 64;
+		// Furthest ahead a client can be scheduled. Later deadlines are clamped, and rescheduled on check.
+		static constexpr lw_ui64 maxTicksAhead = slotsPerLevel * slotsPerLevel - 1;
+
+		struct entry
+		{
+			std::weak_ptr<relayserver::client> client;
+			lw_ui64 tick;
+		};
+		// [0] is one slot per tick, [1] is one slot per slotsPerLevel ticks, cascaded into [0] as they come up
+		std::vector<entry> levels[2][slotsPerLevel];
+		lw_ui64 currentTick = 0;
+
+		// Schedules client for a check in the given number of ticks, replacing any earlier schedule
+		void schedule(const std::shared_ptr<relayserver::client>& client, lw_ui64 ticksAhead)
+		{
+			ticksAhead = std::clamp<lw_ui64>(ticksAhead, 1, maxTicksAhead);
+			const lw_ui64 tick = currentTick + ticksAhead;
+			if (client->pingwheeltick == tick)
+				return;
+			client->pingwheeltick = tick;
+
+			if (ticksAhead < slotsPerLevel)
+				levels[0][tick % slotsPerLevel].push_back({ client, tick });
+			else
+				levels[1][(tick / slotsPerLevel) % slotsPerLevel].push_back({ client, tick });
+		}
+
+		// Moves on by one tick, returning the clients that were scheduled for it
+		std::vector<std::shared_ptr<relayserver::client>> advance()
+		{
+			++currentTick;
+
+			// Start of a new round of level 0; move this round's entries down from level 1
+			if (currentTick % slotsPerLevel == 0)
+			{
+				std::vector<entry> cascading;
+				cascading.swap(levels[1][(currentTick / slotsPerLevel) % slotsPerLevel]);
+				for (auto& e : cascading)
+				{
+					const auto client = e.client.lock();
+					if (client && client->pingwheeltick == e.tick)
+						levels[0][e.tick % slotsPerLevel].push_back(std::move(e));
+				}
+			}
+
+			std::vector<entry> slot;
+			slot.swap(levels[0][currentTick % slotsPerLevel]);
+
+			std::vector<std::shared_ptr<relayserver::client>> due;
+			due.reserve(slot.size());
+			for (const auto& e : slot)
+			{
+				auto client = e.client.lock();
+				if (client && client->pingwheeltick == e.tick)
+					due.push_back(std::move(client));
+			}
+			return due;
+		}
+	};
+
+	// handles pingwheel and pingticktime
+	mutable lacewing::readwritelock lock_pingwheel;
+	pingtimerwheel pingwheel;
+	// Time of last ping timer tick, or of ping timer start
+	std::chrono::steady_clock::time_point pingticktime;
+	// If true, next ping timer tick checks and reschedules every client, instead of just due ones
+	std::atomic<bool> pingwheelrescan = true;
+
+	// Starts the ping timer, used when hosting
+	void startpingtimer()
+	{
+		{
+			auto pingWheelWriteLock = lock_pingwheel.createWriteLock();
+			pingticktime = std::chrono::steady_clock::now();
+			pingwheelrescan = true;
+		}
+		pingtimer->start(tcpPingMS / pingTicksPerPingPeriod);
+	}
+
+	// Gets the earliest time pingtimertick() may need to act on this client.
+	// Inactivity is only checked when a TCP or UDP ping is due, so it doesn't need a deadline of its own.
+	std::chrono::steady_clock::time_point nextpingcheck(const relayserver::client& client) const
+	{
+		using std::chrono::milliseconds;
+
+		// Disconnect is on exceeding, not reaching, so we add a ms to any deadline compared with >
+		if (!client.connectRequestApproved)
+			return client.lasttcpmessagetime + milliseconds(std::min(maxNoConnectApprovedMS + 1, tcpPingMS));
+
+		auto next = client.pongedOnTCP ? client.lasttcpmessagetime + milliseconds(tcpPingMS) :
+			client.tcppingsenttime + milliseconds(tcpPingMS);
+		if (!client.pseudoUDP)
+		{
+			if (client.lastudpmessagetime == client.connectRequestApprovedTime)
+				next = std::min(next, client.lastudpmessagetime + milliseconds(udpMaxHelloTimeMS + 1));
+			next = std::min(next, std::max(client.lastudpmessagetime + milliseconds(udpKeepAliveMS),
+				client.udppingsenttime + milliseconds(tcpPingMS)));
+		}
+		return next;
+	}
+
+	// Converts a deadline to number of ping timer ticks from the last tick, rounding up.
+	// Expects lock_pingwheel to be held.
+	lw_ui64 pingticksuntil(std::chrono::steady_clock::time_point deadline) const
+	{
+		const long long tickMS = tcpPingMS / pingTicksPerPingPeriod;
+		const long long msUntil = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - pingticktime).count();
+		if (msUntil <= 0)
+			return 1;
+		return (lw_ui64)((msUntil + tickMS - 1) / tickMS);
+	}
+
 	/** Lacewing server timer function for client pinging and inactivity tests.
 		@remarks There are three things this function does:
+				  Only clients due a check are looked at, as scheduled in pingwheel by nextpingcheck().
 				  1) If the client has not sent a TCP message within tcpPingMS milliseconds, send a ping request.
 				  -> If client still hasn't responded after another tcpPingMS, notify server via error handler,
 					 and disconnect client.
@@ -208,15 +350,16 @@ struct relayserverinternal
 		framebuilder msgBuilderTCP(false), msgBuilderUDP(true);
 		msgBuilderTCP.addheader(11, 0);			/* ping header */
 		msgBuilderUDP.addheader(11, 0, true);	/* ping header, true for UDP */
+		const auto pingTCP = msgBuilderTCP.encode(true, true), pingUDP = msgBuilderUDP.encode(true, false);
 
 		std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
 		auto serverClientListReadLock = server.lock_clientlist.createReadLock();
 		auto serverUDPWriteLock = server.lock_udp.createWriteLock();
-		for (const auto& client : clients)
-		{
-			if (client->_readonly)
-				continue;
+		auto pingWheelWriteLock = lock_pingwheel.createWriteLock();
 
+		// Checks one client; returns false if client is being disconnected, and so needs no further checks.
+		const auto checkclient = [&](const std::shared_ptr<relayserver::client>& client) -> bool
+		{
 			auto msElapsedTCP = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - client->lasttcpmessagetime).count();
 			auto msElapsedNonPing = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - client->lastchannelorpeermessagetime).count();
 
@@ -228,8 +371,9 @@ struct relayserverinternal
 				{
 					client->trustedClient = false;
 					inactivesToDisconnects.push_back(client);
+					return false;
 				}
-				continue;
+				return true;
 			}
 
 			// Psuedo UDP is true unless a UDPHello packet is received, i.e. the client connect handshake UDP packet.
@@ -255,7 +399,7 @@ struct relayserverinternal
 				if (msElapsedUDP > udpMaxHelloTimeMS && client->lastudpmessagetime == client->connectRequestApprovedTime)
 				{
 					inactivesToDisconnects.push_back(client);
-					continue;
+					return false;
 				}
 			}
 
@@ -266,35 +410,37 @@ struct relayserverinternal
 
 				// No UDP keep-alive message needed either, skip both pings
 				if (msElapsedUDP < udpKeepAliveMS)
-					continue;
+					return true;
 			}
 
 			// More than 10 minutes passed, prep to kick for inactivity
 			if (msElapsedNonPing > maxInactivityMS)
 			{
 				inactivesToDisconnects.push_back(client);
-				continue;
+				return false;
 			}
 
 			// pongedOnTCP is true until client hasn't sent a message within PingMS period.
 			// Then it's set to false and a ping message sent, which happens AFTER this if block.
-			// The ping timer ticks again tcpPingMS ms later, and if pongedOnTCP is still false
+			// The client is checked again tcpPingMS ms after the ping, and if pongedOnTCP is still false
 			// (in this if condition), then client hasn't responded to ping, and so should be disconnected.
-			if (!client->pongedOnTCP)
+			// The client may be checked sooner for a UDP deadline, in which case we keep waiting for the reply.
+			if (!client->pongedOnTCP && currentTime - client->tcppingsenttime >= std::chrono::milliseconds(tcpPingMS))
 			{
 				pingUnresponsivesToDisconnect.push_back(client);
-				continue;
+				return false;
 			}
 
-			// Client is sent a ping request: on next pingtimertick(), pongedOnTCP is checked to still be false.
+			// Client is sent a ping request: on next check, pongedOnTCP is checked to still be false.
 			auto cliWriteLock = client->lock.createWriteLock();
 			if (client->_readonly)
-				continue;
+				return false;
 
-			if (msElapsedTCP >= tcpPingMS)
+			if (msElapsedTCP >= tcpPingMS && client->pongedOnTCP)
 			{
 				client->pongedOnTCP = false;
-				msgBuilderTCP.send(client->socket, false);
+				client->tcppingsenttime = currentTime;
+				pingTCP->send(client->socket);
 			}
 
 			// Keep UDP alive by sending a UDP message.
@@ -303,12 +449,37 @@ struct relayserverinternal
 			// Fortunately, we don't actually *need* a ping responses from the client; one-way activity ought to be
 			// enough to keep the UDP psuedo-connections open in routers... assuming, of course, that the UDP packet
 			// goes all the way to the client and thus through all the routers.
-			if (!client->socket->is_websocket() && msElapsedUDP >= udpKeepAliveMS)
+			if (!client->socket->is_websocket() && msElapsedUDP >= udpKeepAliveMS &&
+				currentTime - client->udppingsenttime >= std::chrono::milliseconds(tcpPingMS))
 			{
-				msgBuilderUDP.send(client->udppunch ? client->udppunch : server.udp,
-					client->udplocaladdress, client->ifidx, client->udpremoteaddress, false);
+				client->udppingsenttime = currentTime;
+				pingUDP->send(client->udppunch ? client->udppunch : server.udp,
+					client->udplocaladdress, client->ifidx, client->udpremoteaddress);
 			}
+
+			return true;
+		};
+
+		// Only clients whose next deadline has come up are checked, unless the timer was just started,
+		// in which case everyone is checked, and so rescheduled from now.
+		std::vector<std::shared_ptr<relayserver::client>> dueClients;
+		if (pingwheelrescan.exchange(false))
+			dueClients = clients;
+		else
+			dueClients = pingwheel.advance();
+		pingticktime = currentTime;
+		if (dueClients.empty())
+			return;
+
+		for (const auto& client : dueClients)
+		{
+			if (client->_readonly)
+				continue;
+
+			if (checkclient(client))
+				pingwheel.schedule(client, pingticksuntil(nextpingcheck(*client)));
 		}
+		pingWheelWriteLock.lw_unlock();
 
 		if (pingUnresponsivesToDisconnect.empty() && inactivesToDisconnects.empty())
 			return;
@@ -328,7 +499,7 @@ struct relayserverinternal
 			if (!serverClientListReadLock.isEnabled())
 				serverClientListReadLock.lw_relock();
 
-			if (std::find(clients.begin(), clients.end(), client) != clients.end())
+			if (getclientshared(client.get()))
 			{
 				serverClientListReadLock.lw_unlock();
 				auto clientWriteLock = client->lock.createWriteLock();
@@ -373,7 +544,7 @@ struct relayserverinternal
 
 			if (!serverClientListReadLock.isEnabled())
 				serverClientListReadLock.lw_relock();
-			if (std::find(clients.begin(), clients.end(), client) != clients.end())
+			if (getclientshared(client.get()))
 			{
 				serverClientListReadLock.lw_unlock();
 
@@ -541,181 +712,179 @@ void relayserverinternal::generic_handlerudpreceive(lacewing::udp udp, lacewing:
 	data.remove_prefix(sizeof(type) + sizeof(id));
 
 	auto serverClientListReadLock = server.lock_clientlist.createReadLock();
-	for (const auto& clientsocket : clients)
+	const auto clientsocket = getclientbyid(id);
+	if (clientsocket)
 	{
-		if (clientsocket->_id == id)
-		{
-			serverClientListReadLock.lw_unlock();
-			auto clientWriteLock = clientsocket->lock.createWriteLock();
+		serverClientListReadLock.lw_unlock();
+		auto clientWriteLock = clientsocket->lock.createWriteLock();
 
-			// Note the dereference here. You can do lacewing::address == lacewing::_address,
-			// but not any other combo.
-			// This compares IP only, ignoring ports.
-			if (*clientsocket->udpremoteaddress != remote_address)
+		// Note the dereference here. You can do lacewing::address == lacewing::_address,
+		// but not any other combo.
+		// This compares IP only, ignoring ports.
+		if (*clientsocket->udpremoteaddress != remote_address)
+		{
+			// A client ID was used by the wrong IPv4... hack attempt, or IP is behind double-NAT,
+			// such as T-Mobile CG-NAT, and the TCP + UDP have different IPs.
+			// As a UDP impersonator will result in the real TCP user disconnecting from UDP handshake failing,
+			// it's not a massive security risk, but it is potentially possible to prevent incoming connections
+			// to a server.
+			// 
+			// TODO: The fix would be to pass a secret to the TCP side on connection approval, which must be
+			// echoed back to the UDP side; but Relay wouldn't support that. When we kill Relay compatibility,
+			// that's the method to fix this security issue.
+			//
+			// IPv6 doesn't use NAT, so in theory there should never be an IPv6 difference.
+			// Note that IPv6+4 server sockets always report their IPv4 clients as IPv6 addresses
+			// (mapped to IPv4), so we can't use address->ipv6().
+			const struct in6_addr addrIn6 = remote_address->toin6_addr();
+			if (clientsocket->lockedUDPAddress)
 			{
-				// A client ID was used by the wrong IPv4... hack attempt, or IP is behind double-NAT,
-				// such as T-Mobile CG-NAT, and the TCP + UDP have different IPs.
-				// As a UDP impersonator will result in the real TCP user disconnecting from UDP handshake failing,
-				// it's not a massive security risk, but it is potentially possible to prevent incoming connections
-				// to a server.
-				// 
-				// TODO: The fix would be to pass a secret to the TCP side on connection approval, which must be
-				// echoed back to the UDP side; but Relay wouldn't support that. When we kill Relay compatibility,
-				// that's the method to fix this security issue.
-				//
-				// IPv6 doesn't use NAT, so in theory there should never be an IPv6 difference.
-				// Note that IPv6+4 server sockets always report their IPv4 clients as IPv6 addresses
-				// (mapped to IPv4), so we can't use address->ipv6().
-				const struct in6_addr addrIn6 = remote_address->toin6_addr();
-				if (clientsocket->lockedUDPAddress)
+				// To prevent log slowing the server down, we don't report UDP impersonation.
+				#ifdef _lacewing_debug
+				error error = error_new();
+				error->add("Dropping message");
+				error->add("locked = %s, ipv6 = %s, v4 mapped = %s", clientsocket->lockedUDPAddress ? "yes" : "no",
+					remote_address->ipv6() ? "yes" : "no", IN6_IS_ADDR_V4MAPPED(&addrIn6) ? "yes" : "no"
+				);
+				error->add("Message remote IP \"%s\", client remote IP \"%s\".", remote_address->tostring(stringflags), clientsocket->udpremoteaddress->tostring(stringflags));
+				error->add("Received a UDP message (supposedly) from Client ID %i (version %s), but message doesn't have that client's IP.", id,
+					clientsocket->getimplementation());
+				handlerudperror(udp, error);
+				error_delete(error);
+				if (error)
 				{
-					// To prevent log slowing the server down, we don't report UDP impersonation.
-					#ifdef _lacewing_debug
-					error error = error_new();
-					error->add("Dropping message");
-					error->add("locked = %s, ipv6 = %s, v4 mapped = %s", clientsocket->lockedUDPAddress ? "yes" : "no",
-						remote_address->ipv6() ? "yes" : "no", IN6_IS_ADDR_V4MAPPED(&addrIn6) ? "yes" : "no"
-					);
-					error->add("Message remote IP \"%s\", client remote IP \"%s\".", remote_address->tostring(stringflags), clientsocket->udpremoteaddress->tostring(stringflags));
-					error->add("Received a UDP message (supposedly) from Client ID %i (version %s), but message doesn't have that client's IP.", id,
-						clientsocket->getimplementation());
 					handlerudperror(udp, error);
 					error_delete(error);
-					if (error)
-					{
-						handlerudperror(udp, error);
-						error_delete(error);
-					}
-					#endif // _lacewing_debug
-					udp->send_unreachable(local_address, ifidx, remote_address, foricmp.data(), foricmp.size());
-					return;
 				}
+				#endif // _lacewing_debug
+				udp->send_unreachable(local_address, ifidx, remote_address, foricmp.data(), foricmp.size());
+				return;
+			}
 
-				// Not meant to get UDP from here
-				if (clientsocket->pseudoUDP)
-					return;
-
-				// Unlocked UDP remote address: does incoming datagram match TCP remote address?
-				// We don't require a full match for an unlocked IP address.
-				// IP may mismatch between TCP + UDP even for a valid client, if NAT is getting involved on either side.
-				const lw_ui32 cmp = lw_memcmp_diff_index((const unsigned char*)&clientsocket->addressInt, (const unsigned char*)&addrIn6, sizeof(addrIn6));
-				if (cmp != -1)
-				{
-					const lw_bool isIPv4Mapped = IN6_IS_ADDR_V4MAPPED(&addrIn6);
-					lw_log_if_debug("!!! Mismatch %s IP detected. Differs at index %u.\n",
-						remote_address->ipv6() ? (isIPv4Mapped ? "ipv4-mapped" : "ipv6") : "ipv4", cmp);
-					// If IP is IPv4, under CG-NAT, it should match by first two IPv4 bytes, but not necessarily the rest.
-					// IPv6 takes up 4 bytes of padding before IPv4, so we expect at least a match up to 6.
-					if (!isIPv4Mapped || cmp < 6)
-						return;
-				}
+			// Not meant to get UDP from here
+			if (clientsocket->pseudoUDP)
+				return;
 
-				// Got a UDP address for this client
-				lwp_trace("Locked UDP address for client ID %hu, from \"%s\" to \"%s\".\n", clientsocket->id(),
-					clientsocket->udpremoteaddress->tostring(stringflags), remote_address->tostring(stringflags));
+			// Unlocked UDP remote address: does incoming datagram match TCP remote address?
+			// We don't require a full match for an unlocked IP address.
+			// IP may mismatch between TCP + UDP even for a valid client, if NAT is getting involved on either side.
+			const lw_ui32 cmp = lw_memcmp_diff_index((const unsigned char*)&clientsocket->addressInt, (const unsigned char*)&addrIn6, sizeof(addrIn6));
+			if (cmp != -1)
+			{
+				const lw_bool isIPv4Mapped = IN6_IS_ADDR_V4MAPPED(&addrIn6);
+				lw_log_if_debug("!!! Mismatch %s IP detected. Differs at index %u.\n",
+					remote_address->ipv6() ? (isIPv4Mapped ? "ipv4-mapped" : "ipv6") : "ipv4", cmp);
+				// If IP is IPv4, under CG-NAT, it should match by first two IPv4 bytes, but not necessarily the rest.
+				// IPv6 takes up 4 bytes of padding before IPv4, so we expect at least a match up to 6.
+				if (!isIPv4Mapped || cmp < 6)
+					return;
+			}
 
-				//auto clientWriteLock = clientsocket->lock.createWriteLock();
-				lacewing::address_delete(clientsocket->udplocaladdress);
-				lacewing::address_delete(clientsocket->udpremoteaddress);
-				clientsocket->udplocaladdress = lacewing::address_new(local_address);
-				clientsocket->ifidx = ifidx;
-				clientsocket->udpremoteaddress = lacewing::address_new(remote_address);
-				clientsocket->lockedUDPAddress = true;
+			// Got a UDP address for this client
+			lwp_trace("Locked UDP address for client ID %hu, from \"%s\" to \"%s\".\n", clientsocket->id(),
+				clientsocket->udpremoteaddress->tostring(stringflags), remote_address->tostring(stringflags));
+
+			//auto clientWriteLock = clientsocket->lock.createWriteLock();
+			lacewing::address_delete(clientsocket->udplocaladdress);
+			lacewing::address_delete(clientsocket->udpremoteaddress);
+			clientsocket->udplocaladdress = lacewing::address_new(local_address);
+			clientsocket->ifidx = ifidx;
+			clientsocket->udpremoteaddress = lacewing::address_new(remote_address);
+			clientsocket->lockedUDPAddress = true;
 #ifdef _DEBUG
-				// faulty clients can use ID 0xFFFF and 0x0000
-				if (id != 0 && id != 0xFFFF)
-				{
-					serverClientListReadLock.lw_relock();
-
-					std::shared_ptr<relayserver::client> realSender = nullptr;
-					for (const auto& cs : clients)
-					{
-						if (*cs->udpremoteaddress == remote_address)
-						{
-							realSender = cs;
-							break;
-						}
-					}
+			// faulty clients can use ID 0xFFFF and 0x0000
+			if (id != 0 && id != 0xFFFF)
+			{
+				serverClientListReadLock.lw_relock();
 
-					error error = error_new();
-					error->add("Dropping message");
-					if (realSender)
+				std::shared_ptr<relayserver::client> realSender = nullptr;
+				for (const auto& cs : clients)
+				{
+					if (*cs->udpremoteaddress == remote_address)
 					{
-						error->add("Message may ACTUALLY have originated from client ID %hu, on IP \"%s\".",
-							realSender->id(), realSender->udpremoteaddress->tostring(stringflags));
-						// realSender->socket->close();
+						realSender = cs;
+						break;
 					}
-					error->add("Message IP \"%s\", client IP \"%s\".", remote_address->tostring(stringflags),
-						clientsocket->udpremoteaddress->tostring(stringflags));
-					error->add("Received a UDP message (supposedly) from Client ID %i, but message doesn't have that client's IP.", id);
-					handlerudperror(udp, error);
-					error_delete(error);
 				}
-#endif // _DEBUG
-			}
-			else if (!clientsocket->lockedUDPAddress)
-			{
-				// IP matches, but port does not; the remote port used by a client on UDP often differs from TCP,
-				// due to NAT
-				if (clientsocket->udpremoteaddress->port() != remote_address->port())
-				{
-					lw_log_if_debug("Locked UDP address (port-only) for client ID %hu, from \"%s\" to \"%s\".", clientsocket->id(),
-						clientsocket->udpremoteaddress->tostring(stringflags), remote_address->tostring(stringflags));
 
-					//auto clientWriteLock = clientsocket->lock.createWriteLock();
-					clientsocket->udpremoteaddress->port(remote_address->port());
-				}
-				if (*local_address != clientsocket->udplocaladdress)
+				error error = error_new();
+				error->add("Dropping message");
+				if (realSender)
 				{
-					lw_log_if_debug("Switched local UDP address for client ID %hu, from \"%s\" to \"%s\".", clientsocket->id(),
-						clientsocket->udplocaladdress->tostring(stringflags), local_address->tostring(stringflags));
-					//auto clientWriteLock = clientsocket->lock.createWriteLock();
-					clientsocket->udplocaladdress = lacewing::address_new(local_address);
-					clientsocket->ifidx = ifidx;
+					error->add("Message may ACTUALLY have originated from client ID %hu, on IP \"%s\".",
+						realSender->id(), realSender->udpremoteaddress->tostring(stringflags));
+					// realSender->socket->close();
 				}
-				clientsocket->lockedUDPAddress = true;
-			}
-			// else remote IP matches, and locked: we should be good. If local address changed, something went rather wrong on our side.
-			else if (*local_address != clientsocket->udplocaladdress)
-			{
-				//auto clientWriteLock = clientsocket->lock.createWriteLock();
-				const struct in6_addr addrIn6 = remote_address->toin6_addr();
-				error error = error_new();
-				error->add("locked = %s, ipv6 = %s, v4 mapped = %s", clientsocket->lockedUDPAddress ? "yes" : "no",
-					remote_address->ipv6() ? "yes" : "no", IN6_IS_ADDR_V4MAPPED(&addrIn6) ? "yes" : "no"
-				);
-				error->add("Message local IP \"%s\", client local IP \"%s\"; remote IP \"%s\".",
-					local_address->tostring(stringflags), clientsocket->udplocaladdress->tostring(stringflags),
+				error->add("Message IP \"%s\", client IP \"%s\".", remote_address->tostring(stringflags),
 					clientsocket->udpremoteaddress->tostring(stringflags));
-				error->add("Received a UDP message from Client ID %i (version %s), but message doesn't have expected local IP. Switching.", id,
-					clientsocket->getimplementation());
+				error->add("Received a UDP message (supposedly) from Client ID %i, but message doesn't have that client's IP.", id);
 				handlerudperror(udp, error);
 				error_delete(error);
-				clientsocket->udplocaladdress = lacewing::address_new(local_address);
-				clientsocket->ifidx = ifidx;
 			}
+#endif // _DEBUG
+		}
+		else if (!clientsocket->lockedUDPAddress)
+		{
+			// IP matches, but port does not; the remote port used by a client on UDP often differs from TCP,
+			// due to NAT
+			if (clientsocket->udpremoteaddress->port() != remote_address->port())
+			{
+				lw_log_if_debug("Locked UDP address (port-only) for client ID %hu, from \"%s\" to \"%s\".", clientsocket->id(),
+					clientsocket->udpremoteaddress->tostring(stringflags), remote_address->tostring(stringflags));
 
-
-			// A client ID is set to only have "fake UDP" but used real UDP.
-			// Pseudo setting is wrong, but IP is correct?
-			if (clientsocket->pseudoUDP)
+				//auto clientWriteLock = clientsocket->lock.createWriteLock();
+				clientsocket->udpremoteaddress->port(remote_address->port());
+			}
+			if (*local_address != clientsocket->udplocaladdress)
 			{
-				lacewing::error error = lacewing::error_new();
-				error->add("Client ID %i is set to pseudo-UDP, but received a real UDP packet"
-					" on matching address. Ignoring packet.", id);
-				handlerudperror(udp, error);
-				lacewing::error_delete(error);
-				return;
+				lw_log_if_debug("Switched local UDP address for client ID %hu, from \"%s\" to \"%s\".", clientsocket->id(),
+					clientsocket->udplocaladdress->tostring(stringflags), local_address->tostring(stringflags));
+				//auto clientWriteLock = clientsocket->lock.createWriteLock();
+				clientsocket->udplocaladdress = lacewing::address_new(local_address);
+				clientsocket->ifidx = ifidx;
 			}
+			clientsocket->lockedUDPAddress = true;
+		}
+		// else remote IP matches, and locked: we should be good. If local address changed, something went rather wrong on our side.
+		else if (*local_address != clientsocket->udplocaladdress)
+		{
+			//auto clientWriteLock = clientsocket->lock.createWriteLock();
+			const struct in6_addr addrIn6 = remote_address->toin6_addr();
+			error error = error_new();
+			error->add("locked = %s, ipv6 = %s, v4 mapped = %s", clientsocket->lockedUDPAddress ? "yes" : "no",
+				remote_address->ipv6() ? "yes" : "no", IN6_IS_ADDR_V4MAPPED(&addrIn6) ? "yes" : "no"
+			);
+			error->add("Message local IP \"%s\", client local IP \"%s\"; remote IP \"%s\".",
+				local_address->tostring(stringflags), clientsocket->udplocaladdress->tostring(stringflags),
+				clientsocket->udpremoteaddress->tostring(stringflags));
+			error->add("Received a UDP message from Client ID %i (version %s), but message doesn't have expected local IP. Switching.", id,
+				clientsocket->getimplementation());
+			handlerudperror(udp, error);
+			error_delete(error);
+			clientsocket->udplocaladdress = lacewing::address_new(local_address);
+			clientsocket->ifidx = ifidx;
+		}
 
-			if (*local_address != clientsocket->udplocaladdress)
-				lw_log_if_debug("Local address mismatch: \"%s\" does not match \"%s\".", local_address->tostring(stringflags),
-					clientsocket->udplocaladdress->tostring(stringflags));
 
-			clientWriteLock.lw_unlock();
-			client_messagehandler(clientsocket, type, data, true);
+		// A client ID is set to only have "fake UDP" but used real UDP.
+		// Pseudo setting is wrong, but IP is correct?
+		if (clientsocket->pseudoUDP)
+		{
+			lacewing::error error = lacewing::error_new();
+			error->add("Client ID %i is set to pseudo-UDP, but received a real UDP packet"
+				" on matching address. Ignoring packet.", id);
+			handlerudperror(udp, error);
+			lacewing::error_delete(error);
 			return;
 		}
+
+		if (*local_address != clientsocket->udplocaladdress)
+			lw_log_if_debug("Local address mismatch: \"%s\" does not match \"%s\".", local_address->tostring(stringflags),
+				clientsocket->udplocaladdress->tostring(stringflags));
+
+		clientWriteLock.lw_unlock();
+		client_messagehandler(clientsocket, type, data, true);
+		return;
 	}
 
 	// This extends the delay on ID being held; note that some users will still have pending UDP data
@@ -735,9 +904,10 @@ bool relayserverinternal::tcpmessagehandler (void * tag, lw_ui8 type, const char
 {
 	auto clientPtr = ((relayserver::client *) tag);
 	auto& server = clientPtr->server;
-	auto clientIt = std::find_if(server.clients.cbegin(), server.clients.cend(),
-		[=](auto const &p) { return p.get() == clientPtr; });
-	if (clientIt == server.clients.cend())
+	auto serverClientListReadLock = server.server.lock_clientlist.createReadLock();
+	const auto clientShd = server.getclientshared(clientPtr);
+	serverClientListReadLock.lw_unlock();
+	if (!clientShd)
 	{
 		lacewing::error error = lacewing::error_new();
 		error->add("Dropped TCP message, shared client ptr not found");
@@ -746,7 +916,39 @@ bool relayserverinternal::tcpmessagehandler (void * tag, lw_ui8 type, const char
 		return false;
 	}
 
-	return clientPtr->server.client_messagehandler(*clientIt, type, std::string_view(message, size), false);
+	return server.client_messagehandler(clientShd, type, std::string_view(message, size), false);
+}
+
+void relayserverinternal::addclienttolist(std::shared_ptr<relayserver::client> client)
+{
+	clientsbyid[client->_id] = client;
+	clients.push_back(client);
+
+	auto pingWheelWriteLock = lock_pingwheel.createWriteLock();
+	pingwheel.schedule(client, pingticksuntil(nextpingcheck(*client)));
+}
+void relayserverinternal::removeclientfromlist(const std::shared_ptr<relayserver::client>& client)
+{
+	const auto idIt = clientsbyid.find(client->_id);
+	if (idIt == clientsbyid.end() || idIt->second != client)
+		return;
+	clientsbyid.erase(idIt);
+
+	const auto cliIt = std::find(clients.begin(), clients.end(), client);
+	if (cliIt != clients.end())
+		clients.erase(cliIt);
+}
+std::shared_ptr<relayserver::client> relayserverinternal::getclientbyid(lw_ui16 id) const
+{
+	const auto idIt = clientsbyid.find(id);
+	return idIt == clientsbyid.cend() ? nullptr : idIt->second;
+}
+std::shared_ptr<relayserver::client> relayserverinternal::getclientshared(const relayserver::client* client) const
+{
+	auto clientShd = getclientbyid(client->_id);
+	if (clientShd.get() != client)
+		return nullptr;
+	return clientShd;
 }
 
 void serveractiontimertick(lacewing::timer timer)
@@ -964,7 +1166,7 @@ void relayserverinternal::generic_handlerconnect(lacewing::server server, lacewi
 		auto serverClientListWriteLock = this->server.lock_clientlist.createWriteLock();
 		auto newClient = std::make_shared<relayserver::client>(*this, clientsocket);
 		lw_server_client_set_relay_tag((lw_server_client)clientsocket, newClient.get());
-		this->clients.push_back(newClient);
+		addclienttolist(newClient);
 	}
 
 	// Do not call handlerconnect on relayserverinternal.
@@ -999,16 +1201,13 @@ void relayserverinternal::generic_handlerdisconnect(lacewing::server server, lac
 	client->_readonly = true;
 
 	lacewing::writelock serverClientListWriteLock = this->server.lock_clientlist.createWriteLock();
-	auto clientIt =
-		std::find_if(clients.begin(), clients.end(),
-			[=](const auto &p) { return p.get() == client; });
-	if (clientIt == clients.end())
+	std::shared_ptr<lacewing::relayserver::client> clientShd = getclientshared(client);
+	if (!clientShd)
 	{
 		// The tag is only set as the result of a make_shared stored in server's client list
 		always_log("relayserverinternal::generic_handlerdisconnect(): client not found in server's client list.");
 		return;
 	}
-	std::shared_ptr<lacewing::relayserver::client> clientShd = *clientIt;
 
 	lw_server_client_set_relay_tag((lw_server_client)clientsocket, nullptr);
 
@@ -1018,7 +1217,7 @@ void relayserverinternal::generic_handlerdisconnect(lacewing::server server, lac
 	{
 		// We want count of clients to be accurate for the ondisconnect handler.
 		// Note close_client() will also remove it, if it's the else block.
-		clients.erase(clientIt);
+		removeclientfromlist(clientShd);
 		serverClientListWriteLock.lw_unlock();
 
 		handlerdisconnect(this->server, clientShd);
@@ -1155,21 +1354,16 @@ void relayserverinternal::generic_handlerreceive(lacewing::server server, lacewi
 			// write lock to notice the disconnect func is still write-locking the relay tag, and abort the app.
 			// So, we grab a shared_ptr owner for ourselves
 			auto serverClientListReadLock = internal.server.lock_clientlist.createReadLock();
-			const auto csc = std::find_if(internal.clients.crbegin(), internal.clients.crend(),
-				[=](const auto& s) { return &*s == clientPtr; });
-			if (csc == internal.clients.crend())
+			const auto csc = internal.getclientshared(clientPtr);
+			serverClientListReadLock.lw_unlock();
+			if (!csc)
 			{
-				serverClientListReadLock.lw_unlock();
 				// This direct close may still cause a crash, but no idea what recovery we can do at this point
 				clientsocket->tag(nullptr);
 				clientsocket->close(true);
 			}
 			else
-			{
-				const auto csc2 = *csc;
-				serverClientListReadLock.lw_unlock();
-				csc2->disconnect(csc2, 1003);
-			}
+				csc->disconnect(csc, 1003);
 			return;
 		}
 	}
@@ -1215,21 +1409,16 @@ void relayserverinternal::generic_handlerreceive(lacewing::server server, lacewi
 	// write lock to notice the disconnect func is still write-locking the relay tag, and abort the app.
 	// So, we grab a shared_ptr owner for ourselves
 	auto serverClientListReadLock = internal.server.lock_clientlist.createReadLock();
-	const auto csc = std::find_if(internal.clients.crbegin(), internal.clients.crend(),
-		[=](const auto& s) { return &*s == clientPtr; });
-	if (csc == internal.clients.crend())
+	const auto csc = internal.getclientshared(clientPtr);
+	serverClientListReadLock.lw_unlock();
+	if (!csc)
 	{
-		serverClientListReadLock.lw_unlock();
 		// This direct close may still cause a crash, but no idea what recovery we can do at this point
 		clientsocket->tag(nullptr);
 		clientsocket->close(true);
 	}
 	else
-	{
-		const auto csc2 = *csc;
-		serverClientListReadLock.lw_unlock();
-		csc2->disconnect(csc2, 1008);
-	}
+		csc->disconnect(csc, 1008);
 }
 
 void handlererror(lacewing::server server, lacewing::error error)
@@ -1492,7 +1681,7 @@ void relayserver::host(lacewing::filter &_filter)
 	lacewing::filter_delete(filter);
 
 	relayserverinternal * serverInternal = (relayserverinternal *)internaltag;
-	serverInternal->pingtimer->start(serverInternal->tcpPingMS);
+	serverInternal->startpingtimer();
 	serverInternal->actiontimer->start(serverInternal->actionThreadMS);
 }
 
@@ -1513,7 +1702,7 @@ void relayserver::host_websocket(lw_ui16 portNonSecure, lw_ui16 portSecure)
 	}
 
 	relayserverinternal* serverInternal = (relayserverinternal*)internaltag;
-	serverInternal->pingtimer->start(serverInternal->tcpPingMS);
+	serverInternal->startpingtimer();
 	serverInternal->actiontimer->start(serverInternal->actionThreadMS);
 }
 void relayserver::host_websocket(lacewing::filter& filterNonSecure, lacewing::filter& filterSecure)
@@ -1533,7 +1722,7 @@ void relayserver::host_websocket(lacewing::filter& filterNonSecure, lacewing::fi
 	}
 
 	relayserverinternal* serverInternal = (relayserverinternal*)internaltag;
-	serverInternal->pingtimer->start(serverInternal->tcpPingMS);
+	serverInternal->startpingtimer();
 	serverInternal->actiontimer->start(serverInternal->actionThreadMS);
 }
 
@@ -1765,16 +1954,7 @@ void relayserverinternal::close_client (std::shared_ptr<lacewing::relayserver::c
 	auto serverClientListWriteLock = server.lock_clientlist.createWriteLock();
 
 	// Drop this client from server list (if it exists)
-	for (auto cli = clients.begin(); cli != clients.end(); ++cli)
-	{
-		if (*cli == client)
-		{
-			// LW_ESCALATION_NOTE
-			// auto serverClientListWriteLock = serverClientListReadLock.lw_upgrade();
-			clients.erase(cli);
-			break;
-		}
-	}
+	removeclientfromlist(client);
 }
 
 void relayserver::channel_addclient(std::shared_ptr<relayserver::channel> channel, std::shared_ptr<relayserver::client> client)
@@ -2911,6 +3091,8 @@ void relayserver::channel::send(lw_ui8 subchannel, std::string_view message, lw_
 	if (_readonly)
 		return;
 
+	// Encode once for both protocols, then every member is just a write of the shared frame
+	const auto frame = builder.encode(true, true);
 	for (const auto& e : clients)
 	{
 		// Can have a deadlock where ping timer has client lock and is waiting on channel lock,
@@ -2919,7 +3101,7 @@ void relayserver::channel::send(lw_ui8 subchannel, std::string_view message, lw_
 			continue;
 		auto clientWriteLock = e->lock.createWriteLock();
 		if (!e->_readonly)
-			builder.send(e->socket, false);
+			frame->send(e->socket);
 	}
 }
 
@@ -2942,6 +3124,13 @@ void relayserver::channel::blast(lw_ui8 subchannel, std::string_view message, lw
 	if (_readonly)
 		return;
 
+	// Encode once for both UDP and WebSocket, rather than reformatting per WebSocket member
+	const auto frame = builder.encode(true, true);
+
+	// Members on the shared UDP socket are sent to together after the loop, in batched syscalls
+	std::vector<lw_udp_dest> dests;
+	dests.reserve(clients.size());
+
 	auto serverClientListReadLock = server.server.lock_clientlist.createReadLock();
 	for (const auto& e : clients)
 	{
@@ -2953,17 +3142,16 @@ void relayserver::channel::blast(lw_ui8 subchannel, std::string_view message, lw
 		if (!e->_readonly)
 		{
 			if (e->socket->is_websocket())
-			{
-				builder.send(e->socket, false);
-				builder.revert();
-			}
+				frame->send(e->socket);
+			else if (e->udppunch)
+				frame->send(e->udppunch, e->udplocaladdress, e->ifidx, e->udpremoteaddress);
 			else
-			{
-				builder.send(e->udppunch ? e->udppunch : server.server.udp, e->udplocaladdress,
-					e->ifidx, e->udpremoteaddress, false);
-			}
+				dests.push_back({ (lw_addr)e->udplocaladdress, e->ifidx, (lw_addr)e->udpremoteaddress });
 		}
 	}
+
+	auto serverUDPWriteLock = server.server.lock_udp.createWriteLock();
+	frame->send(server.server.udp, dests);
 }
 
 // Throw all clients off this channel, sending Leave Request Success.
@@ -3132,6 +3320,18 @@ void relayserver::setchannellisting (bool enabled)
 	((relayserverinternal *) internaltag)->channellistingenabled = enabled;
 }
 
+// Only the raw TCP server is spread over reactors; WebSocket and UDP stay on pmp.
+// Handlers then run on several threads, which the client/channel locks already allow for,
+// as the Fusion thread reads and writes through them too.
+void relayserver::setreactorcount(size_t count)
+{
+	socket->reactors(count);
+}
+size_t relayserver::getreactorcount()
+{
+	return socket->reactors();
+}
+
 std::shared_ptr<relayserver::client> relayserver::channel::channelmaster() const
 {
 	lacewing::readlock rl = lock.createReadLock();
@@ -3145,11 +3345,8 @@ void relayserver::client::disconnect(std::shared_ptr<relayserver::client> cli, i
 	if (cli == nullptr && !server.isactiontimerthread())
 	{
 		const auto readLock = server.server.lock_clientlist.createReadLock();
-		const auto cliIt = std::find_if(server.clients.cbegin(), server.clients.cend(), [=](auto a) {
-			return this == &*cli;
-		});
-		assert(cliIt != server.clients.cend());
-		cli = *cliIt;
+		cli = server.getclientshared(this);
+		assert(cli);
 
 		if (server.queue_or_run_action(false, relayserverinternal::action::type::disconnect, nullptr, cli, std::string_view((char *)&websocketReasonCode, sizeof(int))))
 			return;
@@ -3876,6 +4073,9 @@ void relayserver::channel::PeerToChannel(relayserver &server, std::shared_ptr<re
 	builder.add <lw_ui16>(client->_id);
 	builder.add (message);
 
+	// Encoded once for raw and WebSocket members, so the loop below never reformats the message
+	const auto frame = builder.encode(true, true);
+
 	// Loop through and send message to all clients that aren't this one
 
 	// Only need server write lock for shared lw_udp socket
@@ -3883,6 +4083,11 @@ void relayserver::channel::PeerToChannel(relayserver &server, std::shared_ptr<re
 	if (!blasted)
 		serverUDPWriteLock.lw_unlock();
 
+	// Members on the shared UDP socket are sent to together after the loop, in batched syscalls
+	std::vector<lw_udp_dest> dests;
+	if (blasted)
+		dests.reserve(clients.size());
+
 	for (const auto& e : clients)
 	{
 		if (e == client)
@@ -3892,13 +4097,16 @@ void relayserver::channel::PeerToChannel(relayserver &server, std::shared_ptr<re
 		if (e->_readonly)
 			continue;
 
-		if (blasted && !e->pseudoUDP)
-			builder.send(e->udppunch ? e->udppunch : server.udp, e->udplocaladdress, e->ifidx, e->udpremoteaddress, false);
+		if (!blasted || e->pseudoUDP)
+			frame->send(e->socket);
+		else if (e->udppunch)
+			frame->send(e->udppunch, e->udplocaladdress, e->ifidx, e->udpremoteaddress);
 		else
-			builder.send(e->socket, false);
+			dests.push_back({ (lw_addr)e->udplocaladdress, e->ifidx, (lw_addr)e->udpremoteaddress });
 	}
 
-	builder.framereset();
+	if (blasted)
+		frame->send(server.udp, dests);
 }
 
 #define autohandlerfunctions(pub, intern, handlername)			  \
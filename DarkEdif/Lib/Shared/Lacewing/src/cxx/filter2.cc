@@ -71,6 +71,16 @@ void _filter::reuse (bool reuse)
 	lw_filter_set_reuse ((lw_filter) this, reuse);
 }
 
+bool _filter::reuse_port ()
+{
+	return lw_filter_reuse_port ((lw_filter) this);
+}
+
+void _filter::reuse_port (bool reuse_port)
+{
+	lw_filter_set_reuse_port ((lw_filter) this, reuse_port);
+}
+
 bool _filter::ipv6 ()
 {
 	return lw_filter_ipv6 ((lw_filter) this);
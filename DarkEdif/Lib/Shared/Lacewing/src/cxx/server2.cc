@@ -83,6 +83,16 @@ server_client _server::client_first ()
 	return (server_client) lw_server_client_first ((lw_server) this);
 }
 
+void _server::reactors (size_t count)
+{
+	lw_server_set_reactors ((lw_server) this, count);
+}
+
+size_t _server::reactors ()
+{
+	return lw_server_reactors ((lw_server) this);
+}
+
 void _server::hole_punch (lacewing::address remote_addr, lw_ui16 local_port)
 {
 	lw_server_hole_punch ((lw_server) this, (lw_addr)remote_addr, local_port);
@@ -56,6 +56,11 @@ void _udp::send (lacewing::address from, lw_ui32 ifidx, lacewing::address to, co
 	lw_udp_send ((lw_udp) this, (lw_addr) from, ifidx, (lw_addr) to, data, size);
 }
 
+void _udp::send_batch (const lw_udp_dest * dests, size_t count, const char * data, size_t size)
+{
+	lw_udp_send_batch ((lw_udp) this, dests, count, data, size);
+}
+
 void _udp::send_unreachable (lacewing::address from, lw_ui32 ifidx, lacewing::address to, const char * data, size_t size)
 {
 	lw_udp_send_unreachable ((lw_udp) this, (lw_addr) from, ifidx, (lw_addr) to, data, (lw_ui32) size);
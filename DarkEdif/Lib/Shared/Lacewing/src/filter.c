@@ -15,6 +15,8 @@ struct _lw_filter
 {
 	// Turns on socket opt for reuse
 	lw_bool reuse;
+	// Turns on SO_REUSEPORT, so several sockets can share one port (Linux only)
+	lw_bool reuse_port;
 	// IPv6 (possibly dual-stack), or IPv4 only
 	lw_bool ipv6;
 	// Remote address is a mask, not a single address
@@ -39,6 +41,7 @@ lw_filter lw_filter_new ()
 	ctx->remote = 0;
 
 	ctx->reuse = lw_true;
+	ctx->reuse_port = lw_false;
 	ctx->ipv6 = lw_true;
 	ctx->remote_mask = lw_false;
 
@@ -51,6 +54,7 @@ lw_filter lw_filter_clone (lw_filter filter)
 
 	lw_filter_set_ipv6 (ctx, lw_filter_ipv6 (filter));
 	lw_filter_set_reuse (ctx, lw_filter_reuse (filter));
+	lw_filter_set_reuse_port (ctx, lw_filter_reuse_port (filter));
 	lw_filter_set_remote_mask (ctx, lw_filter_remote_mask (filter));
 
 	lw_filter_set_local_port (ctx, lw_filter_local_port (filter));
@@ -139,6 +143,16 @@ lw_bool lw_filter_reuse (lw_filter ctx)
 	return ctx->reuse;
 }
 
+void lw_filter_set_reuse_port (lw_filter ctx, lw_bool enabled)
+{
+	ctx->reuse_port = enabled;
+}
+
+lw_bool lw_filter_reuse_port (lw_filter ctx)
+{
+	return ctx->reuse_port;
+}
+
 void lw_filter_set_remote_mask(lw_filter ctx, lw_bool enabled)
 {
 	ctx->remote_mask = enabled;
@@ -330,6 +344,13 @@ ipv6success:
 	reuse = lw_filter_reuse (filter) ? 1 : 0;
 	lwp_setsockopt (s, SOL_SOCKET, SO_REUSEADDR, (char *)&reuse, sizeof(reuse));
 
+	#ifdef SO_REUSEPORT
+		// Lets each reactor of a lw_server bind its own listening socket to the same port;
+		// the kernel then load-balances incoming connections between them
+		if (lw_filter_reuse_port (filter))
+			lwp_setsockopt (s, SOL_SOCKET, SO_REUSEPORT, (char *)&yes, sizeof(yes));
+	#endif
+
 	memset (&addr, 0, sizeof (addr));
 
 	addr_len = 0;
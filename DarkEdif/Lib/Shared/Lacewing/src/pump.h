@@ -18,6 +18,9 @@ struct _lw_pump
 	long use_count;
 
 	void * tag;
+
+	// Shared timerfd of all lw_timers on this pump, see unix/timer.c; NULL when there's no timers
+	struct _lwp_timer_heap * timer_heap;
 };
 
 void lwp_pump_init (lw_pump ctx, const lw_pumpdef * def);
@@ -17,6 +17,10 @@
 #define HAVE_DECL_TCP_CORK
 //#define HAVE_DECL_TCP_NOPUSH
 #define HAVE_DECL_MSG_NOSIGNAL
+#if __ANDROID_API__ >= 21
+#define HAVE_DECL_RECVMMSG
+#define HAVE_DECL_SENDMMSG
+#endif
 
 // Some guides say to use MSG_NOSIGNAL instead of SO_NOSIGPIPE on Android,
 // but that seems to create error 92, protocol not available
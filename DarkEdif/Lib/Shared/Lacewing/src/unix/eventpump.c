@@ -273,6 +273,15 @@ void lw_eventpump_post_eventloop_exit (lw_eventpump ctx)
 	lw_sync_release (ctx->sync_signals);
 }
 
+lw_bool lw_eventpump_set_io_uring (lw_bool enabled)
+{
+	#ifdef _lacewing_use_io_uring
+		return lwp_eventqueue_set_io_uring (enabled);
+	#else
+		return !enabled;
+	#endif
+}
+
 lw_error lw_eventpump_start_sleepy_ticking
 	(lw_eventpump ctx, void (lw_callback * on_tick_needed) (lw_eventpump))
 {
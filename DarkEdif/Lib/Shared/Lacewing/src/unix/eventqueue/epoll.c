@@ -11,6 +11,336 @@
 #include "../../common.h"
 #include "eventqueue.h"
 
+#ifdef _lacewing_use_io_uring
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* io_uring backend: instead of epoll_ctl, each watched FD has a poll request in an io_uring,
+ * and readiness arrives as completions, with the re-arms of a drain submitted in one
+ * io_uring_enter. Edge-triggered watches use multishot polls, which stay armed; level
+ * watches use one-shot polls, re-armed on the next drain, after the event's been handled.
+ * The events are still epoll_events, so the pump is none the wiser.
+ */
+
+// Off by default; lw_eventpump_set_io_uring picks it for eventqueues made afterwards
+static lw_bool use_io_uring = lw_false;
+
+#define uring_entries 256
+
+struct _lwp_uring_watch
+{
+	int fd;
+	void * tag;
+	lw_ui32 events;
+	lw_bool edge_triggered;
+
+	// Has a poll in the kernel that'll generate more completions
+	lw_bool armed;
+	// Waiting in rearm list
+	lw_bool rearm;
+	// FD no longer watched; freed when neither of the above
+	lw_bool removed;
+};
+typedef struct _lwp_uring_watch * lwp_uring_watch;
+
+struct _lwp_uring
+{
+	int fd;
+
+	void * sq_ring, * cq_ring;
+	size_t sq_ring_size, cq_ring_size;
+	struct io_uring_sqe * sqes;
+
+	unsigned * sq_head, * sq_tail, * sq_mask, * sq_array;
+	unsigned * cq_head, * cq_tail, * cq_mask;
+	struct io_uring_cqe * cqes;
+
+	// Indexed by FD
+	lwp_uring_watch * watches;
+	size_t num_watches;
+
+	lw_list (lwp_uring_watch, rearm);
+};
+
+/* Passes every SQE the kernel hasn't consumed yet; must be called with queue->sync held.
+ * The kernel copies SQEs on submit, so the ring has room again as soon as this returns.
+ */
+static int uring_submit (lwp_uring ctx)
+{
+	const unsigned to_submit = *ctx->sq_tail - __atomic_load_n (ctx->sq_head, __ATOMIC_ACQUIRE);
+	if (to_submit == 0)
+		return 0;
+	return (int) syscall (__NR_io_uring_enter, ctx->fd, to_submit, 0, 0, NULL, 0);
+}
+
+static int uring_wait (lwp_uring ctx)
+{
+	return (int) syscall (__NR_io_uring_enter, ctx->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+static lwp_uring uring_new ()
+{
+	struct io_uring_params params = {0};
+
+	int fd = (int) syscall (__NR_io_uring_setup, uring_entries, &params);
+	if (fd == -1)
+		return NULL;
+
+	// Multishot poll is 5.13+, no direct flag for it, but rsrc tags came in the same release
+	if (!(params.features & IORING_FEAT_RSRC_TAGS) || !(params.features & IORING_FEAT_SINGLE_MMAP))
+	{
+		close (fd);
+		return NULL;
+	}
+
+	lwp_uring ctx = (lwp_uring) lw_calloc_or_exit (1, sizeof (*ctx));
+	ctx->fd = fd;
+
+	ctx->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+	ctx->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+	if (ctx->cq_ring_size > ctx->sq_ring_size)
+		ctx->sq_ring_size = ctx->cq_ring_size;
+
+	// Single mmap: the CQ ring shares the SQ ring's mapping
+	ctx->sq_ring = ctx->cq_ring = mmap (0, ctx->sq_ring_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	ctx->sqes = (struct io_uring_sqe *) mmap (0, params.sq_entries * sizeof (struct io_uring_sqe),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if (ctx->sq_ring == MAP_FAILED || ctx->sqes == MAP_FAILED)
+	{
+		if (ctx->sq_ring != MAP_FAILED)
+			munmap (ctx->sq_ring, ctx->sq_ring_size);
+		if (ctx->sqes != MAP_FAILED)
+			munmap (ctx->sqes, params.sq_entries * sizeof (struct io_uring_sqe));
+		close (fd);
+		free (ctx);
+		return NULL;
+	}
+
+	ctx->sq_head = (unsigned *) ((char *) ctx->sq_ring + params.sq_off.head);
+	ctx->sq_tail = (unsigned *) ((char *) ctx->sq_ring + params.sq_off.tail);
+	ctx->sq_mask = (unsigned *) ((char *) ctx->sq_ring + params.sq_off.ring_mask);
+	ctx->sq_array = (unsigned *) ((char *) ctx->sq_ring + params.sq_off.array);
+
+	ctx->cq_head = (unsigned *) ((char *) ctx->cq_ring + params.cq_off.head);
+	ctx->cq_tail = (unsigned *) ((char *) ctx->cq_ring + params.cq_off.tail);
+	ctx->cq_mask = (unsigned *) ((char *) ctx->cq_ring + params.cq_off.ring_mask);
+	ctx->cqes = (struct io_uring_cqe *) ((char *) ctx->cq_ring + params.cq_off.cqes);
+
+	return ctx;
+}
+
+static void uring_delete (lwp_uring ctx)
+{
+	munmap (ctx->sqes, (*ctx->sq_mask + 1) * sizeof (struct io_uring_sqe));
+	munmap (ctx->sq_ring, ctx->sq_ring_size);
+	close (ctx->fd);
+
+	for (size_t i = 0; i < ctx->num_watches; ++ i)
+		free (ctx->watches [i]);
+	free (ctx->watches);
+
+	list_clear (ctx->rearm);
+
+	free (ctx);
+}
+
+/* Gets a zeroed SQE, passing queued ones to the kernel if the ring is full.
+ * It's not visible to the kernel until uring_queue_sqe. Must be called with queue->sync held.
+ */
+static struct io_uring_sqe * uring_get_sqe (lwp_uring ctx)
+{
+	const unsigned tail = *ctx->sq_tail;
+
+	while (tail - __atomic_load_n (ctx->sq_head, __ATOMIC_ACQUIRE) > *ctx->sq_mask)
+	{
+		if (uring_submit (ctx) == -1 && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+			always_log ("io_uring_enter failed with error %d, SQ is full", errno);
+	}
+
+	const unsigned index = tail & *ctx->sq_mask;
+	struct io_uring_sqe * sqe = &ctx->sqes [index];
+	memset (sqe, 0, sizeof (*sqe));
+
+	ctx->sq_array [index] = index;
+
+	return sqe;
+}
+
+static void uring_queue_sqe (lwp_uring ctx)
+{
+	__atomic_store_n (ctx->sq_tail, *ctx->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static void uring_arm (lwp_uring ctx, lwp_uring_watch watch)
+{
+	struct io_uring_sqe * sqe = uring_get_sqe (ctx);
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = watch->fd;
+	sqe->poll32_events = watch->events;
+	sqe->len = watch->edge_triggered ? IORING_POLL_ADD_MULTI : 0;
+	sqe->user_data = (lw_ui64) (uintptr_t) watch;
+	uring_queue_sqe (ctx);
+
+	watch->armed = lw_true;
+}
+
+static void uring_free_if_done (lwp_uring_watch watch)
+{
+	if (watch->removed && !watch->armed && !watch->rearm)
+		free (watch);
+}
+
+static void uring_remove (lwp_uring ctx, int fd)
+{
+	if (fd < 0 || (size_t) fd >= ctx->num_watches || !ctx->watches [fd])
+		return;
+
+	lwp_uring_watch watch = ctx->watches [fd];
+	ctx->watches [fd] = NULL;
+	watch->removed = lw_true;
+
+	// The poll holds a reference to the file, so a closed socket isn't released until it's cancelled
+	if (watch->armed)
+	{
+		struct io_uring_sqe * sqe = uring_get_sqe (ctx);
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = (lw_ui64) (uintptr_t) watch;
+		sqe->user_data = 0;
+		uring_queue_sqe (ctx);
+
+		uring_submit (ctx);
+	}
+
+	uring_free_if_done (watch);
+}
+
+static void uring_add (lwp_uring ctx, int fd, lw_ui32 events, void * tag)
+{
+	// An FD number reused before the old one's removal
+	uring_remove (ctx, fd);
+
+	if ((size_t) fd >= ctx->num_watches)
+	{
+		size_t num_watches = ctx->num_watches ? ctx->num_watches : 64;
+		while (num_watches <= (size_t) fd)
+			num_watches *= 2;
+
+		ctx->watches = (lwp_uring_watch *) lw_realloc_or_exit (ctx->watches, num_watches * sizeof (lwp_uring_watch));
+		memset (ctx->watches + ctx->num_watches, 0, (num_watches - ctx->num_watches) * sizeof (lwp_uring_watch));
+		ctx->num_watches = num_watches;
+	}
+
+	lwp_uring_watch watch = (lwp_uring_watch) lw_calloc_or_exit (1, sizeof (*watch));
+	watch->fd = fd;
+	watch->tag = tag;
+	watch->edge_triggered = (events & EPOLLET) != 0;
+	watch->events = events & ~EPOLLET;
+
+	ctx->watches [fd] = watch;
+
+	// Submitted now, as the pump thread may be waiting; re-arms are batched by uring_drain instead
+	uring_arm (ctx, watch);
+	uring_submit (ctx);
+}
+
+static int uring_drain (lwp_eventqueue queue, lw_bool block, int max_events, lwp_eventqueue_event * events)
+{
+	lwp_uring ctx = queue->uring;
+	int count = 0;
+
+	for (;;)
+	{
+		lw_sync_lock (queue->sync);
+
+		// Level-triggered watches whose last event has been handled by now
+		list_each (lwp_uring_watch, ctx->rearm, watch)
+		{
+			watch->rearm = lw_false;
+			if (watch->removed)
+				uring_free_if_done (watch);
+			else
+				uring_arm (ctx, watch);
+		}
+		list_clear (ctx->rearm);
+
+		// Completions are only consumed by this thread, so the CQ can be checked unlocked
+		const lw_bool wait = block && *ctx->cq_head == __atomic_load_n (ctx->cq_tail, __ATOMIC_ACQUIRE);
+
+		// Changes made by other threads while this waits are submitted by them
+		const int res = uring_submit (ctx);
+
+		lw_sync_release (queue->sync);
+
+		if ((res == -1 && errno != EBUSY) || (wait && uring_wait (ctx) == -1 && errno != EBUSY))
+			return -1;
+
+		lw_sync_lock (queue->sync);
+
+		unsigned head = *ctx->cq_head;
+		const unsigned tail = __atomic_load_n (ctx->cq_tail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail && count < max_events; ++ head)
+		{
+			const struct io_uring_cqe * cqe = &ctx->cqes [head & *ctx->cq_mask];
+			lwp_uring_watch watch = (lwp_uring_watch) (uintptr_t) cqe->user_data;
+
+			// POLL_REMOVE result
+			if (!watch)
+				continue;
+
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+			{
+				watch->armed = lw_false;
+
+				if (!watch->removed)
+				{
+					watch->rearm = lw_true;
+					list_push (lwp_uring_watch, ctx->rearm, watch);
+				}
+			}
+
+			if (watch->removed || cqe->res < 0)
+			{
+				uring_free_if_done (watch);
+				continue;
+			}
+
+			events [count].events = (lw_ui32) cqe->res;
+			events [count].data.ptr = watch->tag;
+			++ count;
+		}
+
+		__atomic_store_n (ctx->cq_head, head, __ATOMIC_RELEASE);
+
+		lw_sync_release (queue->sync);
+
+		// Only cancellations came in, so go back to waiting
+		if (count > 0 || !block)
+			return count;
+	}
+}
+
+lw_bool lwp_eventqueue_set_io_uring (lw_bool enabled)
+{
+	if (enabled)
+	{
+		lwp_uring test = uring_new ();
+		if (!test)
+			return lw_false;
+		uring_delete (test);
+	}
+
+	use_io_uring = enabled;
+	return lw_true;
+}
+
+#endif
+
 lwp_eventqueue lwp_eventqueue_new ()
 {
 	lwp_eventqueue queue = (lwp_eventqueue)malloc(sizeof(_lw_eventqueue));
@@ -21,6 +351,11 @@ lwp_eventqueue lwp_eventqueue_new ()
 	queue->epollFD = epoll_create (32);
 	queue->numFDsWatched = 0;
 
+	#ifdef _lacewing_use_io_uring
+		// Falls back to epoll if the kernel turns it down, e.g. under seccomp
+		queue->uring = use_io_uring ? uring_new () : NULL;
+	#endif
+
 	// TODO: Phi note 23/12/2025: This queue fds and sync should be unnecessary.
 	// Once stability has been ensured, consider dumping it.
 	queue->sync = lw_sync_new();
@@ -55,6 +390,10 @@ void lwp_eventqueue_delete (lwp_eventqueue queue)
 	}
 	close (queue->epollFD);
 	queue->epollFD = -1;
+	#ifdef _lacewing_use_io_uring
+		if (queue->uring)
+			uring_delete (queue->uring);
+	#endif
 	lw_sync_release(queue->sync);
 
 	free (queue);
@@ -80,6 +419,11 @@ void lwp_eventqueue_add (lwp_eventqueue queue,
 
 	lw_sync_lock(queue->sync);
 
+		#ifdef _lacewing_use_io_uring
+			if (queue->uring)
+				uring_add (queue->uring, fd, event.events, tag);
+			else
+		#endif
 		epoll_ctl (queue->epollFD, EPOLL_CTL_ADD, fd, &event);
 
 		++queue->numFDsWatched;
@@ -128,6 +472,14 @@ void lwp_eventqueue_update (lwp_eventqueue queue,
 			assert(lw_false);
 		}
 
+		#ifdef _lacewing_use_io_uring
+			if (queue->uring)
+			{
+				uring_add (queue->uring, fd, event.events, tag);
+				res = 0;
+			}
+			else
+		#endif
 		res = epoll_ctl(queue->epollFD, EPOLL_CTL_MOD, fd, &event);
 		if (res == -1)
 			always_log("epoll_ctl mod for fd %d, epoll fd %d returned -1, err %d", fd, queue->epollFD, errno);
@@ -162,6 +514,12 @@ void lwp_eventqueue_update (lwp_eventqueue queue,
 				}
 			}
 
+			#ifdef _lacewing_use_io_uring
+				// Unlike epoll, a poll keeps a closed FD's socket alive, so it must be cancelled
+				if (queue->uring)
+					uring_remove (queue->uring, fd);
+			#endif
+
 			// TODO: Phi 22nd Dec 2025: fd should've been closed by higher ups, and not ever valid here,
 			// epoll will auto-remove closed FDs; retaining them via watch->fd is bad,
 			// and should only be used for confirming which FDs are still alive
@@ -186,6 +544,11 @@ int lwp_eventqueue_drain (lwp_eventqueue queue,
 						  int max_events,
 						  lwp_eventqueue_event * events)
 {
+	#ifdef _lacewing_use_io_uring
+		if (queue->uring)
+			return uring_drain (queue, block, max_events, events);
+	#endif
+
 	return epoll_wait (queue->epollFD, events, max_events, block ? -1 : 0);
 }
 
@@ -24,6 +24,17 @@
 	*/
 	typedef struct _lw_eventqueue * lwp_eventqueue;
 
+	#ifdef HAVE_LINUX_IO_URING_H
+		#include <linux/io_uring.h>
+		#define _lacewing_use_io_uring
+		typedef struct _lwp_uring * lwp_uring;
+
+		/* Use io_uring for eventqueues created after this, if the kernel supports it.
+		 * Returns false if io_uring was asked for but isn't available.
+		 */
+		lw_bool lwp_eventqueue_set_io_uring (lw_bool enabled);
+	#endif
+
 	typedef struct _lwp_fd_monitoring
 	{
 		int fd;
@@ -38,6 +49,10 @@
 		int numFDsWatched;
 		lw_sync sync;
 		lw_list(_lwp_fd_monitoring, fds);
+		#ifdef _lacewing_use_io_uring
+			// If set, FDs are polled through this instead of epollFD
+			lwp_uring uring;
+		#endif
 	} _lw_eventqueue;
 	typedef struct epoll_event lwp_eventqueue_event;
 
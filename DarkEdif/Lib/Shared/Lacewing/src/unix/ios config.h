@@ -18,6 +18,8 @@
 #if __DARWIN_C_LEVEL >= 200809L
 #define HAVE_DECL_MSG_NOSIGNAL
 #endif
+//#define HAVE_DECL_RECVMMSG
+//#define HAVE_DECL_SENDMMSG
 #define HAVE_DECL_SO_NOSIGPIPE
 
 #define HAVE_TIMEGM
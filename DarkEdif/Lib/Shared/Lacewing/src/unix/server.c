@@ -28,6 +28,23 @@ static void on_client_data (lw_stream, void * tag, const char * buffer,
 	static void on_ssl_handshook (lwp_sslclient ssl, void * tag);
 #endif
 
+/* An extra event loop for lw_server_set_reactors. Each reactor has its own
+ * SO_REUSEPORT listening socket, so the kernel spreads accepts between them,
+ * and every client it accepts is pumped by its eventpump for its whole life.
+ */
+typedef struct _lw_server_reactor
+{
+	lw_server server;
+
+	int socket;
+
+	lw_eventpump pump;
+	lw_pump_watch pump_watch;
+
+	lw_thread thread;
+
+} * lw_server_reactor;
+
 struct _lw_server
 {
 	int socket;
@@ -53,6 +70,14 @@ struct _lw_server
 	#endif
 
 	lw_list (lw_server_client, clients);
+
+	// Guards clients; recursive, as connect/close hooks can run while it's held
+	lw_sync sync_clients;
+
+	// Extra reactors beyond ctx->pump; reactor_count includes ctx->pump
+	size_t reactor_count;
+	size_t num_reactors;
+	lw_server_reactor reactors;
 };
 
 struct _lw_server_client
@@ -141,6 +166,8 @@ static lw_server_client lwp_server_client_new (lw_server ctx, lw_pump pump, int
 
 	lwp_retain (client, "on_ssl_handshook");
 
+	lw_sync_lock (server->sync_clients);
+
 	if (server->on_connect)
 		server->on_connect (server, client);
 
@@ -149,11 +176,14 @@ static lw_server_client lwp_server_client_new (lw_server ctx, lw_pump pump, int
 	{
 		/* Client was deleted by connect hook
 		*/
+		lw_sync_release (server->sync_clients);
 		return;
 	}
 
 	list_push (lw_server_client, server->clients, client);
 	client->elem = list_elem_back (lw_server_client, server->clients);
+
+	lw_sync_release (server->sync_clients);
  }
 
 #endif
@@ -168,6 +198,8 @@ lw_server lw_server_new (lw_pump pump)
 		return 0;
 
 	ctx->pump = pump;
+	ctx->sync_clients = lw_sync_new ();
+	ctx->reactor_count = 1;
 
 	#ifdef _lacewing_npn
 		lwp_trace ("NPN is available");
@@ -192,6 +224,8 @@ void lw_server_delete (lw_server ctx)
 		SSL_CTX_free(ctx->ssl_context);
 #endif
 
+	lw_sync_delete (ctx->sync_clients);
+
 	free (ctx);
 }
 
@@ -205,12 +239,12 @@ void * lw_server_tag (lw_server ctx)
 	return ctx->tag;
 }
 
-static lw_bool add_client_internal(lw_server ctx,
+static lw_bool add_client_internal(lw_server ctx, lw_pump pump,
 	struct sockaddr_storage * remote_addr, lwp_socket fd, lw_bool accepted)
 {
 	lwp_trace("%s FD %d", accepted ? "hole punch adding" : "accepted", fd);
 
-	lw_server_client client = lwp_server_client_new(ctx, ctx->pump, fd);
+	lw_server_client client = lwp_server_client_new(ctx, pump, fd);
 
 	if (!client)
 	{
@@ -240,12 +274,16 @@ static lw_bool add_client_internal(lw_server ctx,
 
 		lwp_retain(client, "on_connect");
 
+		// Held over the hook, so it can walk the client list while other reactors accept
+		lw_sync_lock(ctx->sync_clients);
+
 		if (ctx->on_connect)
 			ctx->on_connect(ctx, client);
 
 		if (lwp_release(client, "on_connect") ||
 			((lw_stream)client)->flags & lwp_stream_flag_dead)
 		{
+			lw_sync_release(ctx->sync_clients);
 			if (ctx->on_disconnect)
 				ctx->on_disconnect(ctx, client);
 			/* Client was deleted by connect hook
@@ -256,6 +294,8 @@ static lw_bool add_client_internal(lw_server ctx,
 		list_push(lw_server_client, ctx->clients, client);
 		client->elem = list_elem_back(lw_server_client, ctx->clients);
 
+		lw_sync_release(ctx->sync_clients);
+
 #ifdef ENABLE_SSL
 	}
 	else
@@ -281,10 +321,8 @@ static lw_bool add_client_internal(lw_server ctx,
 	return lw_true;
 }
 
-static void listen_socket_read_ready (void * tag)
+static void accept_clients (lw_server ctx, lw_pump pump, int socket)
 {
-	lw_server ctx = (lw_server)tag;
-
 	struct sockaddr_storage address;
 	socklen_t address_length = sizeof (address);
 
@@ -294,18 +332,132 @@ static void listen_socket_read_ready (void * tag)
 
 	  lwp_trace ("Trying to accept...");
 
-	  if ((fd = accept (ctx->socket, (struct sockaddr *) &address,
+	  if ((fd = accept (socket, (struct sockaddr *) &address,
 						&address_length)) == -1)
 	  {
 		 lwp_trace ("Failed to accept: %s", strerror (errno));
 		 break;
 	  }
 
-	  if (add_client_internal(ctx, &address, fd, lw_true))
+	  if (add_client_internal(ctx, pump, &address, fd, lw_true))
 		  return;
 	}
 }
 
+static void listen_socket_read_ready (void * tag)
+{
+	lw_server ctx = (lw_server)tag;
+
+	accept_clients (ctx, ctx->pump, ctx->socket);
+}
+
+static void reactor_socket_read_ready (void * tag)
+{
+	lw_server_reactor reactor = (lw_server_reactor)tag;
+
+	accept_clients (reactor->server, (lw_pump) reactor->pump, reactor->socket);
+}
+
+static int reactor_thread (lw_server_reactor reactor)
+{
+	lw_eventpump_start_eventloop (reactor->pump);
+	return 0;
+}
+
+/* Posted to a reactor's own thread, so its clients are closed by the loop that owns them.
+ * The exit is posted last, after the removes queued by closing the sockets.
+ */
+static void reactor_shutdown (lw_server_reactor reactor)
+{
+	lw_server ctx = reactor->server;
+
+	lw_pump_remove ((lw_pump) reactor->pump, reactor->pump_watch, "lw_server reactor shutdown");
+	reactor->pump_watch = NULL;
+
+	close (reactor->socket);
+	reactor->socket = -1;
+
+	lw_sync_lock (ctx->sync_clients);
+	list_each(lw_server_client, ctx->clients, e) {
+		if (e->fdstream.stream.pump == (lw_pump) reactor->pump)
+			lw_stream_close(&e->fdstream.stream, lw_true);
+	}
+	lw_sync_release (ctx->sync_clients);
+
+	lw_eventpump_post_eventloop_exit (reactor->pump);
+}
+
+static void stop_reactors (lw_server ctx)
+{
+	for (size_t i = 0; i < ctx->num_reactors; ++ i)
+	{
+		lw_server_reactor reactor = &ctx->reactors [i];
+
+		if (lw_thread_started (reactor->thread))
+		{
+			lw_pump_post ((lw_pump) reactor->pump, (void *) reactor_shutdown, reactor);
+			lw_thread_join (reactor->thread);
+		}
+		else if (reactor->socket != -1)
+			close (reactor->socket);
+
+		lw_thread_delete (reactor->thread);
+		lw_pump_delete ((lw_pump) reactor->pump);
+	}
+
+	free (ctx->reactors);
+	ctx->reactors = NULL;
+	ctx->num_reactors = 0;
+}
+
+static void start_reactors (lw_server ctx, lw_filter filter)
+{
+	ctx->reactors = (lw_server_reactor)lw_calloc_or_exit (ctx->reactor_count - 1, sizeof (*ctx->reactors));
+
+	for (size_t i = 0; i < ctx->reactor_count - 1; ++ i)
+	{
+		lw_server_reactor reactor = &ctx->reactors [ctx->num_reactors];
+		lw_error error = lw_error_new ();
+
+		reactor->server = ctx;
+
+		if ((reactor->socket = lwp_create_server_socket
+				(filter, SOCK_STREAM, IPPROTO_TCP, NULL, error)) == -1
+			|| listen (reactor->socket, SOMAXCONN) == -1)
+		{
+			if (reactor->socket != -1)
+			{
+				lw_error_add (error, errno);
+				close (reactor->socket);
+			}
+
+			// The main socket is still accepting, so just run with fewer reactors
+			lw_error_addf (error, "Creating reactor %d of %d, continuing with %d",
+				(int) (i + 2), (int) ctx->reactor_count, (int) (ctx->num_reactors + 1));
+
+			if (ctx->on_error)
+				ctx->on_error (ctx, error);
+
+			lw_error_delete (error);
+			break;
+		}
+
+		lw_error_delete (error);
+
+		lwp_make_nonblocking (reactor->socket);
+
+		reactor->pump = lw_eventpump_new ();
+		reactor->pump_watch = lw_pump_add ((lw_pump) reactor->pump, reactor->socket,
+			"lw_server reactor", reactor, reactor_socket_read_ready, 0, lw_true);
+
+		reactor->thread = lw_thread_new ("lw_server reactor", (void *) reactor_thread);
+
+		++ ctx->num_reactors;
+
+		lw_thread_start (reactor->thread, reactor);
+	}
+}
+
 typedef struct _lw_hole_punch_params {
 	lw_server server;
 	lwp_socket sock;
@@ -318,7 +470,7 @@ typedef struct _lw_hole_punch_params {
 static lw_callback void hole_punch_socket_first_data(lw_hole_punch_params * params)
 {
 	lw_pump_remove(params->server->pump, params->watch, "hole_punch_socket_first_data removing");
-	add_client_internal(params->server, &params->addr, params->sock, lw_false);
+	add_client_internal(params->server, params->server->pump, &params->addr, params->sock, lw_false);
 	lwp_release(params->server, "hole punch");
 }
 
@@ -395,6 +547,17 @@ void lw_server_host_filter (lw_server ctx, lw_filter filter)
 
 	lw_error error = lw_error_new ();
 
+	// Reactors share the port, so every listening socket needs SO_REUSEPORT
+	lw_filter reactor_filter = NULL;
+
+	#ifdef SO_REUSEPORT
+		if (ctx->reactor_count > 1)
+		{
+			filter = reactor_filter = lw_filter_clone (filter);
+			lw_filter_set_reuse_port (filter, lw_true);
+		}
+	#endif
+
 	if ((ctx->socket = lwp_create_server_socket
 			(filter, SOCK_STREAM, IPPROTO_TCP, NULL, error)) == -1)
 	{
@@ -404,6 +567,7 @@ void lw_server_host_filter (lw_server ctx, lw_filter filter)
 			ctx->on_error (ctx, error);
 
 		lw_error_delete (error);
+		lw_filter_delete (reactor_filter);
 		return;
 	}
 
@@ -418,6 +582,7 @@ void lw_server_host_filter (lw_server ctx, lw_filter filter)
 		 ctx->on_error (ctx, error);
 
 	  lw_error_delete (error);
+	  lw_filter_delete (reactor_filter);
 	  return;
 	}
 
@@ -428,6 +593,14 @@ void lw_server_host_filter (lw_server ctx, lw_filter filter)
 	ctx->pump_watch = lw_pump_add (ctx->pump, ctx->socket, name,
 		ctx, listen_socket_read_ready, 0, lw_true);
 
+	// Main socket is bound, so a port of 0 is now resolved for the reactors to share
+	if (reactor_filter)
+	{
+		lw_filter_set_local_port (reactor_filter, lw_server_port (ctx));
+		start_reactors (ctx, reactor_filter);
+		lw_filter_delete (reactor_filter);
+	}
+
 	lw_error_delete (error);
 }
 
@@ -442,10 +615,15 @@ void lw_server_unhost (lw_server ctx)
 	lw_pump_remove(ctx->pump, ctx->pump_watch, "lw_server_unhost");
 	ctx->pump_watch = NULL;
 
+	// Reactor clients are closed on their own threads; what's left is on ctx->pump
+	stop_reactors (ctx);
+
 	// Not having this leaves lw_server_client connections open but server is closed
+	lw_sync_lock (ctx->sync_clients);
 	list_each(lw_server_client, ctx->clients, e) {
 		lw_stream_close(&e->fdstream.stream, lw_true);
 	}
+	lw_sync_release (ctx->sync_clients);
 }
 
 lw_bool lw_server_hosting (lw_server ctx)
@@ -455,7 +633,23 @@ lw_bool lw_server_hosting (lw_server ctx)
 
 size_t lw_server_num_clients (lw_server ctx)
 {
-	return list_length (ctx->clients);
+	lw_sync_lock (ctx->sync_clients);
+	size_t count = list_length (ctx->clients);
+	lw_sync_release (ctx->sync_clients);
+
+	return count;
+}
+
+void lw_server_set_reactors (lw_server ctx, size_t count)
+{
+	#ifdef SO_REUSEPORT
+		ctx->reactor_count = count ? count : 1;
+	#endif
+}
+
+size_t lw_server_reactors (lw_server ctx)
+{
+	return ctx->reactor_count;
 }
 
 int lw_server_port (lw_server ctx)
@@ -790,11 +984,13 @@ void on_client_close (lw_stream stream, void * tag)
 		 ctx->on_disconnect (ctx, client);
 	}
 
+	lw_sync_lock (ctx->sync_clients);
 	if (client->elem)
 	{
 		list_elem_remove(client->elem);
 		client->elem = NULL;
 	}
+	lw_sync_release (ctx->sync_clients);
 
 	#ifdef ENABLE_SSL
 	  if (client->ssl)
@@ -816,11 +1012,13 @@ void lw_server_on_data (lw_server ctx, lw_server_hook_data on_data)
 
 	  if (!ctx->on_data)
 	  {
+		 lw_sync_lock (ctx->sync_clients);
 		 list_each (lw_server_client, ctx->clients, client)
 		 {
 			lw_stream_add_hook_data ((lw_stream) client, on_client_data, client);
 			lw_stream_read ((lw_stream) client, SIZE_MAX);
 		 }
+		 lw_sync_release (ctx->sync_clients);
 	  }
 
 	  return;
@@ -828,10 +1026,12 @@ void lw_server_on_data (lw_server ctx, lw_server_hook_data on_data)
 
 	/* Setting on_data to 0 */
 
+	lw_sync_lock (ctx->sync_clients);
 	list_each (lw_server_client, ctx->clients, client)
 	{
 	  lw_stream_remove_hook_data ((lw_stream) client, on_client_data, client);
 	}
+	lw_sync_release (ctx->sync_clients);
 }
 
 lwp_def_hook (server, connect)
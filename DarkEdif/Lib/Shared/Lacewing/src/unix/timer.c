@@ -11,10 +11,35 @@
 #include "../common.h"
 #include "eventpump.h"
 
+#ifdef _lacewing_use_timerfd
+
+	/* Every timer on a pump shares the one timerfd, armed for whichever started timer is due
+	 * first, kept in a min-heap on due time. So a pump with many timers still has one FD in its
+	 * epoll queue, and a wakeup ticks all the timers that are due.
+	 */
+	struct _lwp_timer_heap
+	{
+		lw_pump pump;
+		lw_pump_watch pump_watch;
+
+		int fd;
+
+		// Recursive, so a tick handler can start and stop timers
+		lw_sync sync;
+
+		// Timers on this pump, started or not; the heap is freed when the last is deleted
+		size_t num_timers;
+
+		// Started timers, soonest due first
+		lw_timer * heap;
+		size_t count, capacity;
+	};
+
+#endif
+
 struct _lw_timer
 {
 	lw_pump pump;
-	lw_pump_watch pump_watch;
 
 	lw_timer_hook_tick on_tick;
 
@@ -23,7 +48,12 @@ struct _lw_timer
 	lw_bool started;
 
 	#ifdef _lacewing_use_timerfd
-		int fd;
+		struct _lwp_timer_heap * timer_heap;
+
+		// Monotonic time of next tick, in nanoseconds
+		lw_i64 due;
+		// Index in timer_heap->heap, or SIZE_MAX if not in it
+		size_t heap_index;
 	#endif
 
 	lw_event stop_event;
@@ -34,20 +64,196 @@ struct _lw_timer
 	char * timer_name;
 };
 
+#ifdef _lacewing_use_timerfd
+
+static lw_i64 monotonic_ns ()
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (lw_i64)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static lw_bool heap_less (struct _lwp_timer_heap * ctx, size_t a, size_t b)
+{
+	return ctx->heap [a]->due < ctx->heap [b]->due;
+}
+
+static void heap_swap (struct _lwp_timer_heap * ctx, size_t a, size_t b)
+{
+	lw_timer t = ctx->heap [a];
+	ctx->heap [a] = ctx->heap [b];
+	ctx->heap [b] = t;
+
+	ctx->heap [a]->heap_index = a;
+	ctx->heap [b]->heap_index = b;
+}
+
+static void heap_sift (struct _lwp_timer_heap * ctx, size_t i)
+{
+	while (i > 0 && heap_less (ctx, i, (i - 1) / 2))
+	{
+		heap_swap (ctx, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+
+	for (;;)
+	{
+		size_t smallest = i, left = i * 2 + 1, right = left + 1;
+
+		if (left < ctx->count && heap_less (ctx, left, smallest))
+			smallest = left;
+		if (right < ctx->count && heap_less (ctx, right, smallest))
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		heap_swap (ctx, i, smallest);
+		i = smallest;
+	}
+}
+
+static void heap_push (struct _lwp_timer_heap * ctx, lw_timer timer)
+{
+	if (ctx->count == ctx->capacity)
+	{
+		ctx->capacity = ctx->capacity ? ctx->capacity * 2 : 8;
+		ctx->heap = (lw_timer *)lw_realloc_or_exit (ctx->heap, ctx->capacity * sizeof (lw_timer));
+	}
+
+	timer->heap_index = ctx->count;
+	ctx->heap [ctx->count ++] = timer;
+	heap_sift (ctx, timer->heap_index);
+}
+
+static void heap_erase (struct _lwp_timer_heap * ctx, lw_timer timer)
+{
+	const size_t i = timer->heap_index;
+
+	if (i == SIZE_MAX)
+		return;
+
+	if (i != -- ctx->count)
+	{
+		heap_swap (ctx, i, ctx->count);
+		heap_sift (ctx, i);
+	}
+
+	timer->heap_index = SIZE_MAX;
+}
+
+/* Arms the timerfd for the first due timer, or disarms it if none are started.
+ * Must be called with ctx->sync held.
+ */
+static void heap_arm (struct _lwp_timer_heap * ctx)
+{
+	struct itimerspec spec = {0};
+
+	if (ctx->count > 0)
+	{
+		// A zero it_value disarms, so a timer that's already due is set to fire 1ns in
+		lw_i64 due = ctx->heap [0]->due;
+		spec.it_value.tv_sec = due / 1000000000;
+		spec.it_value.tv_nsec = due % 1000000000;
+		if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec)
+			spec.it_value.tv_nsec = 1;
+	}
+
+	timerfd_settime (ctx->fd, TFD_TIMER_ABSTIME, &spec, 0);
+}
+
+static void heap_release (struct _lwp_timer_heap * ctx);
+
+static void heap_tick (struct _lwp_timer_heap * ctx)
+{
+	lw_i64 expirations;
+	ssize_t s = read (ctx->fd, &expirations, sizeof (lw_i64));
+	(void)s;
+
+	lw_sync_lock (ctx->sync);
+
+	// In case the last timer is deleted in a tick handler
+	++ ctx->num_timers;
+
+	const lw_i64 now = monotonic_ns ();
+
+	// Rescheduled before its handler runs, and unlocked during it, as the handler may
+	// start, stop or delete any timer, or take locks another thread holds while starting one
+	while (ctx->count > 0 && ctx->heap [0]->due <= now)
+	{
+		lw_timer timer = ctx->heap [0];
+		const lw_i64 interval = (lw_i64)timer->interval * 1000000;
+
+		// Like a timerfd per timer, missed intervals are rolled into this one tick
+		timer->due += interval;
+		if (timer->due <= now)
+			timer->due = now + interval;
+
+		heap_sift (ctx, 0);
+
+		lw_sync_release (ctx->sync);
+
+		if (timer->on_tick)
+			timer->on_tick (timer);
+
+		lw_sync_lock (ctx->sync);
+	}
+
+	heap_arm (ctx);
+
+	lw_sync_release (ctx->sync);
+
+	heap_release (ctx);
+}
+
+static struct _lwp_timer_heap * heap_acquire (lw_pump pump)
+{
+	struct _lwp_timer_heap * ctx = pump->timer_heap;
+
+	if (ctx)
+	{
+		lw_sync_lock (ctx->sync);
+		++ ctx->num_timers;
+		lw_sync_release (ctx->sync);
+		return ctx;
+	}
+
+	ctx = (struct _lwp_timer_heap *)lw_calloc_or_exit (1, sizeof (*ctx));
+
+	ctx->pump = pump;
+	ctx->num_timers = 1;
+	ctx->sync = lw_sync_new ();
+	ctx->fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK);
+	ctx->pump_watch = lw_pump_add (pump, ctx->fd, "lw_timer heap", ctx, (lw_pump_callback)heap_tick, 0, lw_true);
+
+	pump->timer_heap = ctx;
+
+	return ctx;
+}
+
+static void heap_release (struct _lwp_timer_heap * ctx)
+{
+	lw_sync_lock (ctx->sync);
+	const size_t num_timers = -- ctx->num_timers;
+	lw_sync_release (ctx->sync);
+
+	if (num_timers > 0)
+		return;
+
+	ctx->pump->timer_heap = NULL;
+
+	close (ctx->fd);
+	lw_pump_remove (ctx->pump, ctx->pump_watch, "lw_timer heap delete");
+	lw_sync_delete (ctx->sync);
+	free (ctx->heap);
+	free (ctx);
+}
+
+#endif
+
 static void timer_tick (lw_timer ctx)
 {
 	if (ctx->on_tick)
 		ctx->on_tick (ctx);
-
-	#ifdef _lacewing_use_timerfd
-		lw_i64 expirations;
-		ssize_t s = read (ctx->fd, &expirations, sizeof (lw_i64));
-		(void)s;
-		int e = errno;
-		(void)e;
-		assert(s > 0);
-		// TODO: why was expirations read here? Is there an abort?
-	#endif
 }
 
 static void timer_thread (void * ptr)
@@ -81,9 +287,8 @@ lw_timer lw_timer_new (lw_pump pump, const char * timer_name)
 	ctx->timer_thread = lw_thread_new (buffer, (void *)timer_thread);
 
 	#ifdef _lacewing_use_timerfd
-		lwp_snprintf(buffer, sizeof(buffer), "lw_timer %s", timer_name);
-		ctx->fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK);
-		ctx->pump_watch = lw_pump_add (ctx->pump, ctx->fd, buffer, ctx, (lw_pump_callback)timer_tick, 0, lw_true);
+		ctx->timer_heap = heap_acquire (pump);
+		ctx->heap_index = SIZE_MAX;
 	#endif
 
 	return ctx;
@@ -97,8 +302,7 @@ void lw_timer_delete (lw_timer ctx)
 	lw_event_delete (ctx->stop_event);
 
 	#ifdef _lacewing_use_timerfd
-		close (ctx->fd);
-		lw_pump_remove(ctx->pump, ctx->pump_watch, "lw_timer delete");
+		heap_release (ctx->timer_heap);
 	#endif
 
 	lw_thread_delete (ctx->timer_thread);
@@ -141,12 +345,22 @@ void lw_timer_start (lw_timer ctx, long interval)
 
 	#elif defined(_lacewing_use_timerfd)
 
-		struct itimerspec spec;
+		// A zeroed timerfd never fired, so nor does a zero interval here
+		if (interval <= 0)
+			return;
 
-		spec.it_value.tv_sec = spec.it_interval.tv_sec  = interval / 1000;
-		spec.it_value.tv_nsec = spec.it_interval.tv_nsec = (interval % 1000) * 1000000;
+		struct _lwp_timer_heap * heap = ctx->timer_heap;
 
-		timerfd_settime (ctx->fd, 0, &spec, 0);
+		lw_sync_lock (heap->sync);
+
+		ctx->due = monotonic_ns () + (lw_i64)interval * 1000000;
+		heap_push (heap, ctx);
+
+		// Only need to rearm if this is now the first due
+		if (heap->heap [0] == ctx)
+			heap_arm (heap);
+
+		lw_sync_release (heap->sync);
 
 	#else
 
@@ -192,8 +406,14 @@ void lw_timer_stop (lw_timer ctx)
 		}
 
 	#elif defined(_lacewing_use_timerfd)
-		struct itimerspec spec = {0};
-		timerfd_settime (ctx->fd, 0, &spec, 0);
+		struct _lwp_timer_heap * heap = ctx->timer_heap;
+
+		lw_sync_lock (heap->sync);
+
+		// The timerfd is left armed if this was first due; a spare wakeup ticks nothing
+		heap_erase (heap, ctx);
+
+		lw_sync_release (heap->sync);
 	#endif
 
 	ctx->started = lw_false;
@@ -11,6 +11,35 @@
 #include "../common.h"
 #include "../address.h"
 
+/* Number of datagrams read or sent per syscall, where recvmmsg/sendmmsg are available.
+ * The receive buffers are allocated on first read, so this is ~64KiB of memory each.
+ */
+#ifndef lwp_udp_batch_size
+	#define lwp_udp_batch_size 8
+#endif
+
+#ifndef HAVE_DECL_RECVMMSG
+	#undef lwp_udp_batch_size
+	#define lwp_udp_batch_size 1
+#endif
+
+typedef char lwp_udp_cmsgbuf [CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+struct _lwp_udp_recv_batch
+{
+	#ifdef HAVE_DECL_RECVMMSG
+		struct mmsghdr msgs [lwp_udp_batch_size];
+	#else
+		struct msghdr msgs [lwp_udp_batch_size];
+	#endif
+	struct iovec iovs [lwp_udp_batch_size];
+	struct sockaddr_storage from [lwp_udp_batch_size];
+	lwp_udp_cmsgbuf cmsgbufs [lwp_udp_batch_size];
+
+	// + 1 for the null terminator added after the datagram
+	char buffers [lwp_udp_batch_size][lwp_default_buffer_size + 1];
+};
+
 struct _lw_udp
 {
 	lwp_refcounted;
@@ -29,40 +58,121 @@ struct _lw_udp
 	long receives_posted;
 	long writes_posted;
 
+	struct _lwp_udp_recv_batch * recv;
+
 	void * tag;
 };
 
+/* Reads the local address and interface the datagram arrived on from its pktinfo cmsg.
+ * local is the sender's address with the IP swapped for ours, as it always has been.
+ */
+static lw_ui32 read_pktinfo (struct msghdr * msg, struct sockaddr_storage * local)
+{
+	for (struct cmsghdr * hdr = CMSG_FIRSTHDR(msg); hdr; hdr = CMSG_NXTHDR(msg, hdr))
+	{
+		if (hdr->cmsg_level == IPPROTO_IPV6 && hdr->cmsg_type == IPV6_PKTINFO)
+		{
+			struct in6_pktinfo* const recvLocalAddr = (struct in6_pktinfo*)CMSG_DATA(hdr);
+			((struct sockaddr_in6*)local)->sin6_family = AF_INET6;
+			((struct sockaddr_in6*)local)->sin6_addr = recvLocalAddr->ipi6_addr;
+			return recvLocalAddr->ipi6_ifindex;
+		}
+		if (hdr->cmsg_level == IPPROTO_IP && hdr->cmsg_type == IP_PKTINFO)
+		{
+			struct in_pktinfo* const recvLocalAddr = (struct in_pktinfo*)CMSG_DATA(hdr);
+			((struct sockaddr_in*)local)->sin_family = AF_INET;
+			((struct sockaddr_in*)local)->sin_addr.s_addr = recvLocalAddr->ipi_addr.s_addr;
+			return (lw_ui32)recvLocalAddr->ipi_ifindex;
+		}
+	}
+
+	assert(!"No pktinfo cmsg");
+	return 0; // guess
+}
+
+static void on_datagram (lw_udp ctx, struct msghdr * msg, char * buffer, size_t bytes)
+{
+	struct _lw_addr remote_addr = { 0 }, local_addr = { 0 };
+
+	// Success but nothing - 0 bytes of data in UDP datagram?
+	if (bytes == 0)
+	{
+		lw_log_if_debug("Warning from recvmsg: Got 0 bytes. Datagram ignored.\n");
+		return;
+	}
+
+	lwp_addr_set_sockaddr(&remote_addr, (struct sockaddr*)msg->msg_name);
+
+	// Does not match expected incoming filter, discard it
+	if (!lw_filter_check_remote_addr(ctx->filter, &remote_addr))
+	{
+		lw_log_if_debug("Dropping incoming UDP packet from unexpected remote address \"%s\".\n",
+			lw_addr_tostring(&remote_addr, lw_addr_tostring_flag_box_ipv6));
+		lwp_addr_cleanup(&remote_addr);
+		return;
+	}
+
+	struct sockaddr_storage local = *(struct sockaddr_storage *)msg->msg_name;
+	const lw_ui32 ifidx = read_pktinfo(msg, &local);
+	if (ifidx)
+		lwp_addr_set_sockaddr(&local_addr, (struct sockaddr*)&local);
+
+	buffer [bytes] = 0;
+
+	// There's a race where UDP is unhosted, and ctx->on_data() is still queued.
+	// We can't unset on_data as the UDP is merely unhosted, not deleted.
+	// However, the FD is now close()'d and invalid.
+	// TODO: This check may not be necessary due to the shutdown() and manual dropping
+	// of FD from epoll in the same commit on 17th July 2021, but since it's a cheap test,
+	// we'll keep it.
+	if (ctx->fd != -1 && ctx->on_data)
+		ctx->on_data(ctx, ifidx ? &local_addr : NULL, ifidx, &remote_addr, buffer, bytes);
+
+	lwp_addr_cleanup(&local_addr);
+	lwp_addr_cleanup(&remote_addr);
+}
+
 static void read_ready (void * ptr)
 {
 	lw_udp ctx = (lw_udp)ptr;
 
-	struct sockaddr_storage from;
-	socklen_t from_size = sizeof (from);
-
-	char buffer [lwp_default_buffer_size];
-	char cmsgbuf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(struct in_pktinfo))];
-	struct cmsghdr* const cmsg = (struct cmsghdr*)cmsgbuf;
-	struct iovec iov = { .iov_base = buffer, .iov_len = sizeof(buffer) };
-	struct msghdr msg = {
-		.msg_control = cmsgbuf,
-		.msg_controllen = sizeof(cmsgbuf),
-		.msg_name = &from,
-		.msg_namelen = from_size,
-		.msg_iov = &iov,
-		.msg_iovlen = 1,
-		.msg_flags = 0,
-	};
+	if (!ctx->recv)
+		ctx->recv = (struct _lwp_udp_recv_batch *)lw_malloc_or_exit(sizeof(*ctx->recv));
 
-	lwp_retain(ctx, "udp read");
+	struct _lwp_udp_recv_batch * const batch = ctx->recv;
 
-	struct _lw_addr remote_addr = { 0 }, local_addr = { 0 };
-	lw_ui32 ifidx;
+	lwp_retain(ctx, "udp read");
 
-	for (;;)
+	// An on_data handler may unhost, so stop as soon as the FD goes
+	while (ctx->fd != -1)
 	{
-		ssize_t bytes = recvmsg(ctx->fd, &msg, MSG_NOSIGNAL);
+		// The kernel overwrites the name and control lengths, so they're reset every read
+		for (int i = 0; i < lwp_udp_batch_size; ++i)
+		{
+			#ifdef HAVE_DECL_RECVMMSG
+				struct msghdr * const msg = &batch->msgs[i].msg_hdr;
+			#else
+				struct msghdr * const msg = &batch->msgs[i];
+			#endif
+			batch->iovs[i].iov_base = batch->buffers[i];
+			batch->iovs[i].iov_len = lwp_default_buffer_size;
+			msg->msg_name = &batch->from[i];
+			msg->msg_namelen = sizeof(batch->from[i]);
+			msg->msg_iov = &batch->iovs[i];
+			msg->msg_iovlen = 1;
+			msg->msg_control = batch->cmsgbufs[i];
+			msg->msg_controllen = sizeof(batch->cmsgbufs[i]);
+			msg->msg_flags = 0;
+		}
 
-		if (bytes == -1)
+		#ifdef HAVE_DECL_RECVMMSG
+			const int count = recvmmsg(ctx->fd, batch->msgs, lwp_udp_batch_size, MSG_NOSIGNAL, NULL);
+		#else
+			const ssize_t bytes = recvmsg(ctx->fd, &batch->msgs[0], MSG_NOSIGNAL);
+			const int count = bytes == -1 ? -1 : 1;
+		#endif
+
+		if (count == -1)
 		{
 			// Ignore, we already processed the messages
 			if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -71,70 +181,18 @@ static void read_ready (void * ptr)
 			break;
 		}
 
-		// Success but nothing - 0 bytes of data in UDP datagram?
-		if (bytes == 0)
+		for (int i = 0; i < count && ctx->fd != -1; ++i)
 		{
-			lw_log_if_debug("Warning from recvmsg: Got 0 bytes. read_ready ignored.\n");
-			break;
+			#ifdef HAVE_DECL_RECVMMSG
+				on_datagram(ctx, &batch->msgs[i].msg_hdr, batch->buffers[i], batch->msgs[i].msg_len);
+			#else
+				on_datagram(ctx, &batch->msgs[i], batch->buffers[i], (size_t)bytes);
+			#endif
 		}
 
-		// Does not match expected incoming filter, discard it
-		if (!lw_filter_check_remote_addr(ctx->filter, &remote_addr))
-		{
-			lw_log_if_debug("Dropping incoming UDP packet from unexpected remote address \"%s\".\n",
-				lw_addr_tostring(&remote_addr, lw_addr_tostring_flag_box_ipv6));
-			lwp_addr_cleanup(&remote_addr);
-			memset(&remote_addr, 0, sizeof(remote_addr));
-			continue;
-		}
-
-		struct cmsghdr* hdr = (struct cmsghdr*)cmsg;
-		
-		// IP4 pkt info given for IP6 incoming address, or vice versa; skip to next
-		if ((from.ss_family == AF_INET6) != (hdr->cmsg_level == IPPROTO_IPV6))
-		{
-			hdr = CMSG_NXTHDR(&msg, hdr);
-		}
-		if (cmsg->cmsg_type == IPV6_PKTINFO)
-		{
-			assert(remote_addr.info->ai_addr->sa_family == AF_INET6);
-			struct in6_pktinfo* const recvLocalAddr = (struct in6_pktinfo*)CMSG_DATA(cmsg);
-			((struct sockaddr_in6*)&from)->sin6_family = AF_INET6;
-			((struct sockaddr_in6*)&from)->sin6_addr = recvLocalAddr->ipi6_addr;
-			lwp_addr_set_sockaddr(&local_addr, (struct sockaddr*)&from);
-			ifidx = recvLocalAddr->ipi6_ifindex;
-		}
-		else if (((struct cmsghdr*)cmsg)->cmsg_type == IP_PKTINFO)
-		{
-			assert(remote_addr.info->ai_addr->sa_family == AF_INET);
-			struct in_pktinfo* const recvLocalAddr = (struct in_pktinfo*)CMSG_DATA(cmsg);
-			((struct sockaddr_in*)&from)->sin_family = AF_INET;
-			((struct sockaddr_in*)&from)->sin_addr.s_addr = recvLocalAddr->ipi_addr.s_addr;
-			lwp_addr_set_sockaddr(&local_addr, (struct sockaddr*)&from);
-			ifidx = (unsigned int)recvLocalAddr->ipi_ifindex;
-		}
-		else
-		{
-			ifidx = 0; // guess
-			assert(!"Invalid cmsg type");
-		}
-
-		buffer [bytes] = 0;
-
-		// There's a race where UDP is unhosted, and ctx->on_data() is still queued.
-		// We can't unset on_data as the UDP is merely unhosted, not deleted.
-		// However, the FD is now close()'d and invalid.
-		// TODO: This check may not be necessary due to the shutdown() and manual dropping
-		// of FD from epoll in the same commit on 17th July 2021, but since it's a cheap test,
-		// we'll keep it.
-		if (ctx->fd != -1 && ctx->on_data)
-			ctx->on_data(ctx, ifidx ? &local_addr : NULL, ifidx, &remote_addr, buffer, (size_t)bytes);
-
-		lwp_addr_cleanup(&local_addr);
-		memset(&local_addr, 0, sizeof(local_addr));
-
-		lwp_addr_cleanup(&remote_addr);
-		memset(&remote_addr, 0, sizeof(remote_addr));
+		// Fewer than asked for means the socket is drained; skip the EAGAIN round trip
+		if (count < lwp_udp_batch_size)
+			break;
 	}
 
 	lwp_release(ctx, "udp read");
@@ -261,6 +319,9 @@ void lw_udp_delete (lw_udp ctx)
 
 	lw_udp_unhost (ctx);
 
+	free (ctx->recv);
+	ctx->recv = NULL;
+
 	// We should test if it's freed? But there's not really much the app can do to prevent it,
 	// and the better behaviour is to let whatever's using it free it by itself.
 	lwp_release(ctx, "udp_new"); // calls free (ctx)
@@ -269,6 +330,86 @@ void lw_udp_delete (lw_udp ctx)
 extern lw_bool lw_in_wsl;
 extern const struct in6_addr in6addr_loopback_wsl;
 
+/* Fills msg to send iov to "to", from local address "from" on interface ifidx.
+ * cmsgdata must be CMSG_SPACE(sizeof(struct in6_pktinfo)) bytes.
+ */
+static void prepare_msg (struct msghdr * msg, struct iovec * iov, char * cmsgdata,
+	lw_addr from, lw_ui32 ifidx, lw_addr to)
+{
+	// TODO: Double-check this isn't some sort of IPv6/IPv4 mixup with outgoing local send address
+	// If running under WSL, localhost sendmsg is borked for wsl receiver -> host Windows, but sendto routes properly.
+	if (from && lw_in_wsl &&
+		// Address stored in network order, check 127.x.x.x at big end
+		((from->info->ai_addr->sa_family == AF_INET &&
+			((lw_ui8 *)&(((struct sockaddr_in*)from->info->ai_addr)->sin_addr))[3] == 127) ||
+		// WSL host connecting via localhost: it is likely padded IPv4 of [::ffff:127.0.0.1]
+		!memcmp(&((struct sockaddr_in6*)from->info->ai_addr)->sin6_addr, &in6addr_loopback_wsl, sizeof(struct in6_addr))))
+	{
+		from = NULL;
+	}
+
+	msg->msg_name = to->info->ai_addr;
+	msg->msg_namelen = to->info->ai_addrlen;
+	msg->msg_iov = iov;
+	msg->msg_iovlen = 1;
+	msg->msg_flags = 0;
+
+	// No pktinfo is the same as sendto(), letting the OS pick the outgoing address
+	if (!from)
+	{
+		msg->msg_control = NULL;
+		msg->msg_controllen = 0;
+		return;
+	}
+
+	assert(*(lw_i32 *)&ifidx >= 0); // negative is invalid
+	msg->msg_control = cmsgdata;
+
+	struct cmsghdr* const cmsg = (struct cmsghdr*)cmsgdata;
+	if (from->info->ai_family == AF_INET)
+	{
+		msg->msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+		cmsg->cmsg_level = IPPROTO_IP;
+		cmsg->cmsg_type = IP_PKTINFO;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+
+		struct in_pktinfo* const pktinfo = (struct in_pktinfo*)CMSG_DATA(cmsg);
+		pktinfo->ipi_addr = ((struct sockaddr_in*)from->info->ai_addr)->sin_addr;
+		pktinfo->ipi_ifindex = (int)ifidx;
+	}
+	else // AF_INET6
+	{
+		msg->msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+		cmsg->cmsg_level = IPPROTO_IPV6;
+		cmsg->cmsg_type = IPV6_PKTINFO;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+
+		struct in6_pktinfo* const pktinfo = (struct in6_pktinfo*)CMSG_DATA(cmsg);
+		pktinfo->ipi6_addr = ((struct sockaddr_in6*)from->info->ai_addr)->sin6_addr;
+		pktinfo->ipi6_ifindex = ifidx;
+	}
+}
+
+static void on_send_error (lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to)
+{
+	// Ignore EAGAIN/EWOULDBLOCK since we're sending UDP; if there's not outgoing room
+	// to immediately send, then just discard
+	if (errno == EAGAIN || errno == EWOULDBLOCK)
+		return;
+
+	lw_error error = lw_error_new();
+
+	lw_error_add(error, errno);
+	lw_error_addf(error, "Error sending to %s from local address %s, ifidx %u",
+		lw_addr_tostring(to, lw_addr_tostring_flag_box_ipv6),
+		lw_addr_tostring(from, lw_addr_tostring_flag_box_ipv6), ifidx);
+
+	if (ctx->on_error)
+		ctx->on_error(ctx, error);
+
+	lw_error_delete(error);
+}
+
 void lw_udp_send (lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to, const char * data, size_t size)
 {
 	if (!to || (!lw_addr_ready(to)) || !to->info)
@@ -298,87 +439,17 @@ void lw_udp_send (lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to, const cha
 	lwp_retain(ctx, "udp write");
 	++ctx->writes_posted;
 
-	// TODO: Double-check this isn't some sort of IPv6/IPv4 mixup with outgoing local send address
-	// If running under WSL, localhost sendmsg is borked for wsl receiver -> host Windows, but sendto routes properly.
-	if (from && lw_in_wsl &&
-		// Address stored in network order, check 127.x.x.x at big end
-		((from->info->ai_addr->sa_family == AF_INET &&
-			((lw_ui8 *)&(((struct sockaddr_in*)from->info->ai_addr)->sin_addr))[3] == 127) ||
-		// WSL host connecting via localhost: it is likely padded IPv4 of [::ffff:127.0.0.1]
-		!memcmp(&((struct sockaddr_in6*)from->info->ai_addr)->sin6_addr, &in6addr_loopback_wsl, sizeof(struct in6_addr))))
-	{
-		from = NULL;
-	}
-
 	// Unlike Windows, Linux copies the data passed to sendmsg in non-blocking IO
-	ssize_t res;
-	if (from)
-	{
-		assert(*(lw_i32 *)&ifidx >= 0); // negative is invalid
-		struct iovec iov = { .iov_base = (void*)data, .iov_len = size };
-		char cmsgdata[CMSG_SPACE(sizeof(struct in6_pktinfo))];
-		struct msghdr msg = {
-			.msg_name = to->info->ai_addr,
-			.msg_namelen = to->info->ai_addrlen,
-			.msg_iov = &iov,
-			.msg_iovlen = 1,
-			.msg_control = cmsgdata,
-			.msg_flags = 0
-		};
-		struct cmsghdr* const cmsg = (struct cmsghdr*)cmsgdata;
-		if (from->info->ai_family == AF_INET)
-		{
-			msg.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
-			cmsg->cmsg_level = IPPROTO_IP;
-			cmsg->cmsg_type = IP_PKTINFO;
-			cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
-
-			struct in_pktinfo* const pktinfo = (struct in_pktinfo*)CMSG_DATA(cmsg);
-			pktinfo->ipi_addr = ((struct sockaddr_in*)from->info->ai_addr)->sin_addr;
-			pktinfo->ipi_ifindex = (int)ifidx;
-		}
-		else // AF_INET6
-		{
-			msg.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
-			cmsg->cmsg_level = IPPROTO_IPV6;
-			cmsg->cmsg_type = IPV6_PKTINFO;
-			cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
-
-			struct in6_pktinfo* const pktinfo = (struct in6_pktinfo*)CMSG_DATA(cmsg);
-			pktinfo->ipi6_addr = ((struct sockaddr_in6*)from->info->ai_addr)->sin6_addr;
-			pktinfo->ipi6_ifindex = ifidx;
-		}
-
-		res = sendmsg(ctx->fd, &msg, MSG_NOSIGNAL);
-	}
-	else
-	{
-		res = sendto(ctx->fd, data, size, MSG_NOSIGNAL, to->info->ai_addr,
-			to->info->ai_addrlen);
-	}
+	struct iovec iov = { .iov_base = (void*)data, .iov_len = size };
+	char cmsgdata[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	struct msghdr msg;
+	prepare_msg(&msg, &iov, cmsgdata, from, ifidx, to);
 
 	// Something went awry
-	if (res == -1)
+	if (sendmsg(ctx->fd, &msg, MSG_NOSIGNAL) == -1)
 	{
 		--ctx->writes_posted;
-
-		// Ignore EAGAIN/EWOULDBLOCK since we're sending UDP; if there's not outgoing room
-		// to immediately send, then just discard
-		if (errno != EAGAIN && errno != EWOULDBLOCK)
-		{
-			lw_error error = lw_error_new();
-
-			lw_error_add(error, errno);
-			lw_error_addf(error, "Error sending to %s from local address %s, ifidx %u",
-				lw_addr_tostring(to, lw_addr_tostring_flag_box_ipv6),
-				lw_addr_tostring(from, lw_addr_tostring_flag_box_ipv6), ifidx);
-
-			if (ctx->on_error)
-				ctx->on_error(ctx, error);
-
-			lw_error_delete(error);
-		}
-
+		on_send_error(ctx, from, ifidx, to);
 		// fall through to lwp_release
 	}
 
@@ -392,6 +463,61 @@ void lw_udp_send (lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to, const cha
 	lwp_release(ctx, "udp write");
 }
 
+void lw_udp_send_batch (lw_udp ctx, const lw_udp_dest * dests, size_t count, const char * data, size_t size)
+{
+	#ifndef HAVE_DECL_SENDMMSG
+		for (size_t i = 0; i < count; ++i)
+			lw_udp_send(ctx, dests[i].local, dests[i].ifidx, dests[i].remote, data, size);
+	#else
+		if (size == SIZE_MAX)
+			size = strlen (data);
+
+		lwp_retain(ctx, "udp write batch");
+
+		struct iovec iov = { .iov_base = (void*)data, .iov_len = size };
+		struct mmsghdr msgs [lwp_udp_batch_size];
+		char cmsgdata [lwp_udp_batch_size][CMSG_SPACE(sizeof(struct in6_pktinfo))];
+		const lw_udp_dest * batch [lwp_udp_batch_size];
+
+		for (size_t i = 0; i < count && ctx->fd != -1; )
+		{
+			unsigned int num = 0;
+			for (; i < count && num < lwp_udp_batch_size; ++i)
+			{
+				// Not ready is an error; let the regular send report it
+				if (!dests[i].remote || !lw_addr_ready(dests[i].remote) || !dests[i].remote->info)
+				{
+					lw_udp_send(ctx, dests[i].local, dests[i].ifidx, dests[i].remote, data, size);
+					continue;
+				}
+
+				batch[num] = &dests[i];
+				prepare_msg(&msgs[num].msg_hdr, &iov, cmsgdata[num], dests[i].local, dests[i].ifidx, dests[i].remote);
+				++num;
+			}
+
+			// sendmmsg stops at the first failing datagram; report it, skip it, and carry on with the rest.
+			// A full send buffer won't empty mid-batch, so the rest of this batch is discarded, as send() would.
+			for (unsigned int sent = 0; sent < num; )
+			{
+				const int res = sendmmsg(ctx->fd, &msgs[sent], num - sent, MSG_NOSIGNAL);
+				if (res == -1)
+				{
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+						break;
+					on_send_error(ctx, batch[sent]->local, batch[sent]->ifidx, batch[sent]->remote);
+					++sent;
+					continue;
+				}
+				ctx->writes_posted += res;
+				sent += (unsigned int)res;
+			}
+		}
+
+		lwp_release(ctx, "udp write batch");
+	#endif
+}
+
 void lw_udp_send_unreachable(lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to, const char* data, lw_ui32 size)
 {
 	lwp_socket icmpsock = lw_addr_ipv6(from) ? ctx->icmpv6fd : ctx->icmpfd;
@@ -10,11 +10,14 @@
 #define HAVE_SYS_PRCTL_H
 #define HAVE_SYS_SENDFILE_H
 #define HAVE_SYS_TIMERFD_H
+#define HAVE_LINUX_IO_URING_H
 
 #define HAVE_DECL_PR_SET_NAME
 #define HAVE_DECL_TCP_CORK
 //#define HAVE_DECL_TCP_NOPUSH
 #define HAVE_DECL_MSG_NOSIGNAL
+#define HAVE_DECL_RECVMMSG
+#define HAVE_DECL_SENDMMSG
 //#define HAVE_DECL_SO_NOSIGPIPE
 
 #define HAVE_TIMEGM
@@ -227,6 +227,11 @@ lw_error lw_eventpump_start_eventloop (lw_eventpump ctx)
 	return 0;
 }
 
+lw_bool lw_eventpump_set_io_uring (lw_bool enabled)
+{
+	return !enabled;
+}
+
 void lw_eventpump_post_eventloop_exit (lw_eventpump ctx)
 {
 	PostQueuedCompletionStatus (ctx->completion_port, 0, 0, sig_exit_event_loop);
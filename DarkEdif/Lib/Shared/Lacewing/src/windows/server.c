@@ -685,6 +685,17 @@ size_t lw_server_num_clients (lw_server ctx)
 	return list_length (ctx->clients);
 }
 
+// IOCP already spreads completions over the pump's worker threads, so Windows
+// servers only ever have the one reactor
+void lw_server_set_reactors (lw_server ctx, size_t count)
+{
+}
+
+size_t lw_server_reactors (lw_server ctx)
+{
+	return 1;
+}
+
 int lw_server_port (lw_server ctx)
 {
 	return lwp_socket_port (ctx->socket);
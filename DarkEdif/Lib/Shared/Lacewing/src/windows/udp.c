@@ -667,6 +667,13 @@ void lw_udp_send (lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to, const cha
 	lwp_release(ctx, "udp write");
 }
 
+// Overlapped sends already queue without a syscall round trip per datagram, so there's no batch API to use
+void lw_udp_send_batch (lw_udp ctx, const lw_udp_dest * dests, size_t count, const char * buffer, size_t size)
+{
+	for (size_t i = 0; i < count; ++i)
+		lw_udp_send (ctx, dests[i].local, dests[i].ifidx, dests[i].remote, buffer, size);
+}
+
 void lw_udp_send_unreachable(lw_udp ctx, lw_addr from, lw_ui32 ifidx, lw_addr to, const char * data, lw_ui32 size)
 {
 	lwp_socket icmpsock = lw_addr_ipv6(from) ? ctx->icmpv6socket : ctx->icmpsocket;